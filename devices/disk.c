@@ -7,6 +7,8 @@
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/trace.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -119,7 +121,7 @@ disk_init (void) {
 			default:
 				NOT_REACHED ();
 		}
-		lock_init (&c->lock);
+		lock_init_named (&c->lock, c->name);
 		c->expecting_interrupt = false;
 		sema_init (&c->completion_wait, 0);
 
@@ -217,12 +219,15 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
 	c = d->channel;
 	lock_acquire (&c->lock);
 	select_sector (d, sec_no);
+	TRACE (TRACE_DISK_SUBMIT, sec_no, false);
 	issue_pio_command (c, CMD_READ_SECTOR_RETRY);
 	sema_down (&c->completion_wait);
 	if (!wait_while_busy (d))
 		PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
 	input_sector (c, buffer);
+	TRACE (TRACE_DISK_COMPLETE, sec_no, false);
 	d->read_cnt++;
+	thread_current ()->rusage.sectors_read++;
 	lock_release (&c->lock);
 }
 
@@ -241,12 +246,15 @@ disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
 	c = d->channel;
 	lock_acquire (&c->lock);
 	select_sector (d, sec_no);
+	TRACE (TRACE_DISK_SUBMIT, sec_no, true);
 	issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
 	if (!wait_while_busy (d))
 		PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
 	output_sector (c, buffer);
 	sema_down (&c->completion_wait);
+	TRACE (TRACE_DISK_COMPLETE, sec_no, true);
 	d->write_cnt++;
+	thread_current ()->rusage.sectors_written++;
 	lock_release (&c->lock);
 }
 
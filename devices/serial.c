@@ -1,7 +1,7 @@
 #include "devices/serial.h"
 #include <debug.h>
+#include <string.h>
 #include "devices/input.h"
-#include "devices/intq.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
@@ -37,6 +37,10 @@
 #define IER_RECV 0x01           /* Interrupt when data received. */
 #define IER_XMIT 0x02           /* Interrupt when transmit finishes. */
 
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /* Enable the receive and transmit FIFOs. */
+#define FCR_XMIT_RESET 0x04     /* Clear the transmit FIFO. */
+
 /* Line Control Register bits. */
 #define LCR_N81 0x03            /* No parity, 8 data bits, 1 stop bit. */
 #define LCR_DLAB 0x80           /* Divisor Latch Access Bit (DLAB). */
@@ -51,11 +55,34 @@
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
 
-/* Data to be transmitted. */
-static struct intq txq;
+/* Number of bytes the transmit FIFO holds.  When THR Empty is
+   set, this many bytes can be written without checking again. */
+#define XMIT_FIFO_SIZE 16
+
+/* Data to be transmitted.
+
+   serial_putbuf() copies whole buffers into this ring and the
+   interrupt handler sends them, so writers keep interrupts off
+   only long enough to claim space and to publish what they
+   copied, not once per byte.  The counters only grow; a byte's
+   slot is its counter modulo TXQ_SIZE.
+
+   A writer can be interrupted by a handler that writes too, so
+   space is claimed by advancing txq_reserved, and the bytes
+   become visible to the interrupt handler only when the last
+   writer copying into the ring finishes and moves txq_tail up to
+   txq_reserved.  The bytes of each serial_putbuf() call that
+   fits in the ring therefore stay together and in order. */
+#define TXQ_SIZE 4096           /* Must be a power of 2. */
+static uint8_t txq[TXQ_SIZE];
+static size_t txq_head;         /* Next byte to send. */
+static size_t txq_tail;         /* End of the bytes ready to send. */
+static size_t txq_reserved;     /* End of the space claimed by writers. */
+static int txq_writers;         /* Writers still copying into the ring. */
 
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
+static void putbuf_poll (const uint8_t *, size_t);
 static void write_ier (void);
 static intr_handler_func serial_interrupt;
 
@@ -70,7 +97,6 @@ init_poll (void) {
 	outb (FCR_REG, 0);                    /* Disable FIFO. */
 	set_serial (115200);                  /* 115.2 kbps, N-8-1. */
 	outb (MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
-	intq_init (&txq);
 	mode = POLL;
 }
 
@@ -88,6 +114,7 @@ serial_init_queue (void) {
 	intr_register_ext (0x20 + 4, serial_interrupt, "serial");
 	mode = QUEUE;
 	old_level = intr_disable ();
+	outb (FCR_REG, FCR_ENABLE | FCR_XMIT_RESET);
 	write_ier ();
 	intr_set_level (old_level);
 }
@@ -95,31 +122,77 @@ serial_init_queue (void) {
 /* Sends BYTE to the serial port. */
 void
 serial_putc (uint8_t byte) {
-	enum intr_level old_level = intr_disable ();
+	serial_putbuf (&byte, 1);
+}
+
+/* Sends the SIZE bytes in BUFFER to the serial port. */
+void
+serial_putbuf (const void *buffer, size_t size) {
+	const uint8_t *buf = buffer;
+	enum intr_level old_level;
 
 	if (mode != QUEUE) {
 		/* If we're not set up for interrupt-driven I/O yet,
-		   use dumb polling to transmit a byte. */
+		   use dumb polling to transmit the bytes. */
+		old_level = intr_disable ();
 		if (mode == UNINIT)
 			init_poll ();
-		putc_poll (byte);
-	} else {
-		/* Otherwise, queue a byte and update the interrupt enable
-		   register. */
-		if (old_level == INTR_OFF && intq_full (&txq)) {
-			/* Interrupts are off and the transmit queue is full.
-			   If we wanted to wait for the queue to empty,
-			   we'd have to reenable interrupts.
-			   That's impolite, so we'll send a character via
-			   polling instead. */
-			putc_poll (intq_getc (&txq));
+		putbuf_poll (buf, size);
+		intr_set_level (old_level);
+		return;
+	}
+
+	while (size > 0) {
+		size_t room, cnt, start, ofs;
+
+		old_level = intr_disable ();
+		room = TXQ_SIZE - (txq_reserved - txq_head);
+		if (room == 0 && old_level == INTR_ON) {
+			/* The ring is full.  Let the interrupt handler drain
+			   it while other threads run. */
+			intr_set_level (old_level);
+			thread_yield ();
+			continue;
 		}
+		if (room == 0) {
+			/* The ring is full and interrupts are off.  Waiting
+			   for it to drain would mean reenabling interrupts.
+			   That's impolite, so send the oldest byte via
+			   polling instead.  If no byte is ready, we
+			   interrupted the writer that claimed the whole ring,
+			   so send ours directly. */
+			if (txq_head == txq_tail) {
+				putbuf_poll (buf, size);
+				intr_set_level (old_level);
+				return;
+			}
+			putc_poll (txq[txq_head++ % TXQ_SIZE]);
+			room = 1;
+		}
+		cnt = size < room ? size : room;
+		start = txq_reserved;
+		txq_reserved += cnt;
+		txq_writers++;
+		intr_set_level (old_level);
+
+		/* Copy with interrupts on, wrapping around the end. */
+		ofs = start % TXQ_SIZE;
+		if (ofs + cnt <= TXQ_SIZE)
+			memcpy (txq + ofs, buf, cnt);
+		else {
+			memcpy (txq + ofs, buf, TXQ_SIZE - ofs);
+			memcpy (txq, buf + (TXQ_SIZE - ofs), cnt - (TXQ_SIZE - ofs));
+		}
+		buf += cnt;
+		size -= cnt;
 
-		intq_putc (&txq, byte);
+		/* Publish the bytes and start the transmitter. */
+		old_level = intr_disable ();
+		if (--txq_writers == 0)
+			txq_tail = txq_reserved;
 		write_ier ();
+		intr_set_level (old_level);
 	}
-
-	intr_set_level (old_level);
 }
 
 /* Flushes anything in the serial buffer out the port in polling
@@ -127,8 +200,8 @@ serial_putc (uint8_t byte) {
 void
 serial_flush (void) {
 	enum intr_level old_level = intr_disable ();
-	while (!intq_empty (&txq))
-		putc_poll (intq_getc (&txq));
+	while (txq_head != txq_tail)
+		putc_poll (txq[txq_head++ % TXQ_SIZE]);
 	intr_set_level (old_level);
 }
 
@@ -171,7 +244,7 @@ write_ier (void) {
 
 	/* Enable transmit interrupt if we have any characters to
 	   transmit. */
-	if (!intq_empty (&txq))
+	if (txq_head != txq_tail)
 		ier |= IER_XMIT;
 
 	/* Enable receive interrupt if we have room to store any
@@ -193,6 +266,13 @@ putc_poll (uint8_t byte) {
 	outb (THR_REG, byte);
 }
 
+/* Transmits the SIZE bytes in BUF by polling. */
+static void
+putbuf_poll (const uint8_t *buf, size_t size) {
+	while (size-- > 0)
+		putc_poll (*buf++);
+}
+
 /* Serial interrupt handler. */
 static void
 serial_interrupt (struct intr_frame *f UNUSED) {
@@ -205,10 +285,13 @@ serial_interrupt (struct intr_frame *f UNUSED) {
 	while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
 		input_putc (inb (RBR_REG));
 
-	/* As long as we have a byte to transmit, and the hardware is
-	   ready to accept a byte for transmission, transmit a byte. */
-	while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0)
-		outb (THR_REG, intq_getc (&txq));
+	/* Once the transmit FIFO is empty, refill it with as many
+	   bytes as it holds. */
+	if ((inb (LSR_REG) & LSR_THRE) != 0) {
+		int i;
+		for (i = 0; i < XMIT_FIFO_SIZE && txq_head != txq_tail; i++)
+			outb (THR_REG, txq[txq_head++ % TXQ_SIZE]);
+	}
 
 	/* Update interrupt enable register based on queue status. */
 	write_ier ();
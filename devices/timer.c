@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/prof.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 
@@ -17,6 +18,10 @@
 
 static int64_t ticks;
 
+/* 프로파일러가 타이머를 PROF_RATE배로 돌릴 때, 이번 tick 안에서
+   몇 번째 인터럽트인지. */
+static unsigned prof_phase;
+
 static unsigned loops_per_tick;
 
 static intr_handler_func timer_interrupt;
@@ -26,7 +31,9 @@ static void real_time_sleep(int64_t num, int32_t denom);
 
 void timer_init(void)
 {
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
+	/* -prof이면 샘플링 주기에 맞춰 더 자주 인터럽트를 받는다. */
+	unsigned freq = TIMER_FREQ * prof_rate;
+	uint16_t count = (1193180 + freq / 2) / freq;
 
 	outb(0x43, 0x34);
 	outb(0x40, count & 0xff);
@@ -108,10 +115,18 @@ void timer_print_stats(void)
 }
 
 static void
-timer_interrupt(struct intr_frame *args UNUSED)
+timer_interrupt(struct intr_frame *args)
 {
+	if (prof_enabled)
+		prof_sample(args);
+
+	/* 인터럽트가 PROF_RATE번 올 때마다 한 tick이 지난다. */
+	if (++prof_phase < prof_rate)
+		return;
+	prof_phase = 0;
+
 	ticks++;
-	thread_tick();
+	thread_tick((args->cs & 3) == 3);
 
 	/*-------------------------[project 1]-------------------------*/
 	/* 깨울 스레드가 있으면 깨우기 */
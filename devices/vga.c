@@ -43,6 +43,13 @@ init (void) {
 	}
 }
 
+/* Number of characters vga_putbuf() writes per batch.  The
+   cursor is moved once per batch, and interrupts are turned back
+   on between batches. */
+#define PUTBUF_BATCH 64
+
+static void putc_at_cursor (int c);
+
 /* Writes C to the VGA text display, interpreting control
    characters in the conventional ways.  */
 void
@@ -52,7 +59,36 @@ vga_putc (int c) {
 	enum intr_level old_level = intr_disable ();
 
 	init ();
+	putc_at_cursor (c);
+	move_cursor ();
+
+	intr_set_level (old_level);
+}
 
+/* Writes the SIZE characters in BUFFER to the VGA text display,
+   like vga_putc() on each of them.  The hardware cursor, which
+   takes two port writes to move, is only updated at the end of
+   each batch of characters. */
+void
+vga_putbuf (const char *buffer, size_t size) {
+	while (size > 0) {
+		size_t cnt = size < PUTBUF_BATCH ? size : PUTBUF_BATCH;
+		enum intr_level old_level = intr_disable ();
+
+		init ();
+		size -= cnt;
+		while (cnt-- > 0)
+			putc_at_cursor ((uint8_t) *buffer++);
+		move_cursor ();
+
+		intr_set_level (old_level);
+	}
+}
+
+/* Writes C at the cursor and advances the cursor, without
+   moving the hardware cursor. */
+static void
+putc_at_cursor (int c) {
 	switch (c) {
 		case '\n':
 			newline ();
@@ -84,11 +120,6 @@ vga_putc (int c) {
 				newline ();
 			break;
 	}
-
-	/* Update cursor position. */
-	move_cursor ();
-
-	intr_set_level (old_level);
 }
 
 /* Clears the screen and moves the cursor to the upper left. */
@@ -1,29 +1,42 @@
 #include "filesys/file.h"
 #include <debug.h>
 #include "filesys/inode.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 
-/* An open file. */
+/* An open file.
+ * Several file descriptors may share one struct file, and with it
+ * the position, as after dup2(); REF_CNT counts them. */
 struct file {
 	struct inode *inode;        /* File's inode. */
 	off_t pos;                  /* Current position. */
 	bool deny_write;            /* Has file_deny_write() been called? */
+	int ref_cnt;                /* Number of references. */
 };
 
+/* Cache of struct file. */
+static struct kmem_cache *file_cache;
+
+/* Initializes the file module. */
+void
+file_init (void) {
+	file_cache = kmem_cache_create ("file", sizeof (struct file), NULL);
+}
+
 /* Opens a file for the given INODE, of which it takes ownership,
  * and returns the new file.  Returns a null pointer if an
  * allocation fails or if INODE is null. */
 struct file *
 file_open (struct inode *inode) {
-	struct file *file = calloc (1, sizeof *file);
+	struct file *file = kmem_cache_alloc (file_cache);
 	if (inode != NULL && file != NULL) {
 		file->inode = inode;
 		file->pos = 0;
 		file->deny_write = false;
+		file->ref_cnt = 1;
 		return file;
 	} else {
 		inode_close (inode);
-		free (file);
+		kmem_cache_free (file_cache, file);
 		return NULL;
 	}
 }
@@ -48,13 +61,30 @@ file_duplicate (struct file *file) {
 	return nfile;
 }
 
-/* Closes FILE. */
+/* Returns FILE after taking another reference to it, for a
+ * second file descriptor that shares FILE's position. */
+struct file *
+file_share (struct file *file) {
+	ASSERT (file != NULL);
+	ASSERT (file->ref_cnt > 0);
+	file->ref_cnt++;
+	return file;
+}
+
+/* Returns true if FILE has more than one reference. */
+bool
+file_is_shared (const struct file *file) {
+	return file->ref_cnt > 1;
+}
+
+/* Drops a reference to FILE, closing it when the last one is
+ * dropped. */
 void
 file_close (struct file *file) {
-	if (file != NULL) {
+	if (file != NULL && --file->ref_cnt == 0) {
 		file_allow_write (file);
 		inode_close (file->inode);
-		free (file);
+		kmem_cache_free (file_cache, file);
 	}
 }
 
@@ -6,6 +6,7 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -33,6 +34,7 @@ struct inode {
 	int open_cnt;                       /* Number of openers. */
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+	void *exec_info;                    /* Loader's parsed headers. */
 	struct inode_disk data;             /* Inode content. */
 };
 
@@ -53,10 +55,14 @@ byte_to_sector (const struct inode *inode, off_t pos) {
  * returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Cache of struct inode. */
+static struct kmem_cache *inode_cache;
+
 /* Initializes the inode module. */
 void
 inode_init (void) {
 	list_init (&open_inodes);
+	inode_cache = kmem_cache_create ("inode", sizeof (struct inode), NULL);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -115,7 +121,7 @@ inode_open (disk_sector_t sector) {
 	}
 
 	/* Allocate memory. */
-	inode = malloc (sizeof *inode);
+	inode = kmem_cache_alloc (inode_cache);
 	if (inode == NULL)
 		return NULL;
 
@@ -125,6 +131,7 @@ inode_open (disk_sector_t sector) {
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
+	inode->exec_info = NULL;
 	disk_read (filesys_disk, inode->sector, &inode->data);
 	return inode;
 }
@@ -164,7 +171,8 @@ inode_close (struct inode *inode) {
 					bytes_to_sectors (inode->data.length)); 
 		}
 
-		free (inode); 
+		free (inode->exec_info);
+		kmem_cache_free (inode_cache, inode);
 	}
 }
 
@@ -176,6 +184,12 @@ inode_remove (struct inode *inode) {
 	inode->removed = true;
 }
 
+/* Returns true if INODE has been removed. */
+bool
+inode_is_removed (const struct inode *inode) {
+	return inode->removed;
+}
+
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
  * Returns the number of bytes actually read, which may be less
  * than SIZE if an error occurs or end of file is reached. */
@@ -240,6 +254,10 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 	if (inode->deny_write_cnt)
 		return 0;
 
+	/* The loader's view of the file is about to go stale. */
+	free (inode->exec_info);
+	inode->exec_info = NULL;
+
 	while (size > 0) {
 		/* Sector to write, starting byte offset within sector. */
 		disk_sector_t sector_idx = byte_to_sector (inode, offset);
@@ -306,6 +324,22 @@ inode_allow_write (struct inode *inode) {
 	inode->deny_write_cnt--;
 }
 
+/* Returns what inode_set_exec_info() last attached to INODE, or a
+ * null pointer if nothing is attached. */
+void *
+inode_get_exec_info (const struct inode *inode) {
+	return inode->exec_info;
+}
+
+/* Attaches INFO, a block obtained from malloc(), to INODE, for the
+ * loader to find when the file is executed again.  INODE frees INFO
+ * when it is written to or closed for the last time. */
+void
+inode_set_exec_info (struct inode *inode, void *info) {
+	free (inode->exec_info);
+	inode->exec_info = info;
+}
+
 /* Returns the length, in bytes, of INODE's data. */
 off_t
 inode_length (const struct inode *inode) {
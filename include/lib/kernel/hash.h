@@ -18,7 +18,19 @@
  * conversion from a struct hash_elem back to a structure object
  * that contains it.  This is the same technique used in the
  * linked list implementation.  Refer to lib/kernel/list.h for a
- * detailed explanation. */
+ * detailed explanation.
+ *
+ * The table grows and shrinks incrementally: when the load goes
+ * out of bounds, a new bucket array is allocated and each later
+ * insertion or deletion moves a few buckets of the old array
+ * into it, so no single operation pays for migrating the whole
+ * table.  Lookups search both arrays in the meantime.
+ *
+ * An open-addressing table, struct ohash, is also provided.  It
+ * keeps its elements in a flat array of slots with Robin Hood
+ * probing and compares them with an equality function, which
+ * makes lookups cheaper than following a chain, at the cost of
+ * rehashing all at once when it grows. */
 
 #include <stdbool.h>
 #include <stddef.h>
@@ -28,6 +40,7 @@
 /* Hash element. */
 struct hash_elem {
 	struct list_elem list_elem;
+	uint64_t hash;              /* Hash value, cached by the table. */
 };
 
 /* Converts pointer to hash element HASH_ELEM into a pointer to
@@ -50,6 +63,12 @@ typedef bool hash_less_func (const struct hash_elem *a,
 		const struct hash_elem *b,
 		void *aux);
 
+/* Returns true if hash elements A and B are equal, given
+ * auxiliary data AUX. */
+typedef bool hash_equal_func (const struct hash_elem *a,
+		const struct hash_elem *b,
+		void *aux);
+
 /* Performs some operation on hash element E, given auxiliary
  * data AUX. */
 typedef void hash_action_func (struct hash_elem *e, void *aux);
@@ -59,6 +78,9 @@ struct hash {
 	size_t elem_cnt;            /* Number of elements in table. */
 	size_t bucket_cnt;          /* Number of buckets, a power of 2. */
 	struct list *buckets;       /* Array of `bucket_cnt' lists. */
+	struct list *old_buckets;   /* Array being migrated, or null. */
+	size_t old_bucket_cnt;      /* Number of buckets in `old_buckets'. */
+	size_t migrate_idx;         /* Next old bucket to migrate. */
 	hash_hash_func *hash;       /* Hash function. */
 	hash_less_func *less;       /* Comparison function. */
 	void *aux;                  /* Auxiliary data for `hash' and `less'. */
@@ -96,5 +118,32 @@ bool hash_empty (struct hash *);
 uint64_t hash_bytes (const void *, size_t);
 uint64_t hash_string (const char *);
 uint64_t hash_int (int);
+uint64_t hash_uint64 (uint64_t);
+
+/* Slot in an open-addressing hash table. */
+struct ohash_slot {
+	uint64_t hash;              /* Hash value of `elem'. */
+	struct hash_elem *elem;     /* Element, or null if empty. */
+};
+
+/* Open-addressing hash table. */
+struct ohash {
+	size_t elem_cnt;            /* Number of elements in table. */
+	size_t slot_cnt;            /* Number of slots, a power of 2. */
+	struct ohash_slot *slots;   /* Array of `slot_cnt' slots. */
+	hash_hash_func *hash;       /* Hash function. */
+	hash_equal_func *equal;     /* Equality function. */
+	void *aux;                  /* Auxiliary data for `hash' and `equal'. */
+};
+
+bool ohash_init (struct ohash *, hash_hash_func *, hash_equal_func *,
+		void *aux);
+void ohash_clear (struct ohash *, hash_action_func *);
+void ohash_destroy (struct ohash *, hash_action_func *);
+struct hash_elem *ohash_insert (struct ohash *, struct hash_elem *);
+struct hash_elem *ohash_find (struct ohash *, struct hash_elem *);
+struct hash_elem *ohash_delete (struct ohash *, struct hash_elem *);
+void ohash_apply (struct ohash *, hash_action_func *);
+size_t ohash_size (struct ohash *);
 
 #endif /* lib/kernel/hash.h */
@@ -0,0 +1,21 @@
+#ifndef __LIB_KERNEL_LZ_H
+#define __LIB_KERNEL_LZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* LZ77 block compression.
+
+   A small, fast compressor in the style of LZ4, meant for pages
+   of memory rather than for files: blocks are at most 64 kB and
+   carry no header, so the caller must remember the sizes. */
+
+/* Size of the scratch buffer that lz_compress() needs. */
+#define LZ_WORK_SIZE (4096 * sizeof (uint16_t))
+
+size_t lz_compress (const void *src, size_t src_size,
+		void *dst, size_t dst_size, void *work);
+size_t lz_decompress (const void *src, size_t src_size,
+		void *dst, size_t dst_size);
+
+#endif /* lib/kernel/lz.h */
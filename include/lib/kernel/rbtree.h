@@ -0,0 +1,121 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Red-black tree.
+ *
+ * A balanced binary search tree: insertion, removal and lookup
+ * take O(log n) time, and the nodes can be visited in order.
+ * Like lists and hash tables, the tree does not allocate memory.
+ * Each structure that can be in a tree embeds a struct rb_node
+ * member, and rb_entry() converts a struct rb_node back to the
+ * structure that contains it:
+ *
+ * struct foo {
+ *   struct rb_node node;
+ *   int64_t key;
+ *   ...other members...
+ * };
+ *
+ * The tree does not know about keys.  rb_insert() and the
+ * search functions take a comparison function, just like
+ * list_insert_ordered().  Elements that compare equal are kept
+ * in insertion order.
+ *
+ * The first element is cached, so rb_first() is O(1) and the
+ * tree doubles as a priority queue.
+ *
+ * A tree may be augmented with data computed from each node's
+ * subtree, by giving rb_init_augmented() a function that
+ * recomputes that data for one node from its children.  The tree
+ * calls it for every node whose subtree changes.  The interval
+ * tree below is built this way. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Red-black tree node. */
+struct rb_node {
+	struct rb_node *parent;     /* Parent, or null for the root. */
+	struct rb_node *left;       /* Left child, or null. */
+	struct rb_node *right;      /* Right child, or null. */
+	bool red;                   /* Node color. */
+};
+
+/* Converts pointer to tree node RB_NODE into a pointer to the
+ * structure that RB_NODE is embedded inside.  Supply the name of
+ * the outer structure STRUCT and the member name MEMBER of the
+ * tree node. */
+#define rb_entry(RB_NODE, STRUCT, MEMBER)                       \
+	((STRUCT *) ((uint8_t *) (RB_NODE)                      \
+		- offsetof (STRUCT, MEMBER)))
+
+/* Compares the value of two tree nodes A and B, given auxiliary
+ * data AUX.  Returns true if A is less than B, or false if A is
+ * greater than or equal to B. */
+typedef bool rb_less_func (const struct rb_node *a,
+		const struct rb_node *b,
+		void *aux);
+
+/* Recomputes the augmented data of NODE from NODE itself and its
+ * children, whose data is up to date. */
+typedef void rb_update_func (struct rb_node *node);
+
+/* Red-black tree. */
+struct rbtree {
+	struct rb_node *root;       /* Root node, or null if empty. */
+	struct rb_node *first;      /* Leftmost node, or null if empty. */
+	rb_update_func *update;     /* Augmented data updater, or null. */
+};
+
+/* Basic life cycle. */
+void rb_init (struct rbtree *);
+void rb_init_augmented (struct rbtree *, rb_update_func *);
+
+/* Insertion and removal. */
+void rb_insert (struct rbtree *, struct rb_node *, rb_less_func *, void *aux);
+void rb_remove (struct rbtree *, struct rb_node *);
+
+/* Search. */
+struct rb_node *rb_find (struct rbtree *, const struct rb_node *,
+		rb_less_func *, void *aux);
+struct rb_node *rb_lower_bound (struct rbtree *, const struct rb_node *,
+		rb_less_func *, void *aux);
+
+/* Traversal. */
+struct rb_node *rb_first (struct rbtree *);
+struct rb_node *rb_last (struct rbtree *);
+struct rb_node *rb_next (struct rb_node *);
+struct rb_node *rb_prev (struct rb_node *);
+
+/* Properties. */
+bool rb_empty (struct rbtree *);
+
+/* Interval tree.
+ *
+ * A red-black tree of closed intervals [START, LAST], ordered by
+ * START and augmented with the largest LAST in each subtree, so
+ * that all the intervals overlapping a given range are found in
+ * O(log n + number found) time:
+ *
+ * for (n = itree_first (&tree, start, last); n != NULL;
+ *      n = itree_next (n, start, last))
+ *   ...n overlaps [start, last]...
+ *
+ * Initialize the tree with itree_init(). */
+struct interval_node {
+	struct rb_node rb;          /* Tree node. */
+	uint64_t start;             /* First point of the interval. */
+	uint64_t last;              /* Last point of the interval. */
+	uint64_t subtree_last;      /* Largest `last' in this subtree. */
+};
+
+void itree_init (struct rbtree *);
+void itree_insert (struct rbtree *, struct interval_node *);
+void itree_remove (struct rbtree *, struct interval_node *);
+struct interval_node *itree_first (struct rbtree *,
+		uint64_t start, uint64_t last);
+struct interval_node *itree_next (struct interval_node *,
+		uint64_t start, uint64_t last);
+
+#endif /* lib/kernel/rbtree.h */
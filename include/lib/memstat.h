@@ -0,0 +1,14 @@
+#ifndef __LIB_MEMSTAT_H
+#define __LIB_MEMSTAT_H
+
+#include <stddef.h>
+
+/* Memory usage of a process, as reported by the memstat system
+ * call.  All sizes are in bytes. */
+struct memstat {
+	size_t rss;             /* Resident set size: mapped frames. */
+	size_t pss;             /* Proportional set size: each frame is
+	                           divided evenly among its mappers. */
+};
+
+#endif /* lib/memstat.h */
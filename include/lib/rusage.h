@@ -0,0 +1,22 @@
+#ifndef __LIB_RUSAGE_H
+#define __LIB_RUSAGE_H
+
+#include <stdint.h>
+
+/* Resources used by a process, as reported by the getrusage
+ * system call. */
+struct rusage {
+	uint64_t user_ticks;        /* Timer ticks spent in user mode. */
+	uint64_t kernel_ticks;      /* Timer ticks spent in the kernel. */
+	uint64_t page_faults;       /* Page faults taken. */
+	uint64_t sectors_read;      /* Disk sectors read. */
+	uint64_t sectors_written;   /* Disk sectors written. */
+	uint64_t context_switches;  /* Times switched away from. */
+};
+
+/* Whose usage getrusage reports. */
+#define RUSAGE_SELF 0           /* The calling process. */
+#define RUSAGE_CHILDREN 1       /* Its children that have been waited
+                                   for, and their waited-for children. */
+
+#endif /* lib/rusage.h */
@@ -36,6 +36,12 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Extras. */
+	SYS_MEMSTAT,                /* Report memory usage of this process. */
+	SYS_SYSRING_ENTER,          /* Run the system calls queued in a ring. */
+	SYS_SPAWN,                  /* Start a new process running a program. */
+	SYS_GETRUSAGE,              /* Report resources used by a process. */
 };
 
 #endif /* lib/syscall-nr.h */
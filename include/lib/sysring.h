@@ -0,0 +1,37 @@
+#ifndef __LIB_SYSRING_H
+#define __LIB_SYSRING_H
+
+#include <stdint.h>
+
+/* Number of entries in each queue of a system call ring.  Must
+ * be a power of 2. */
+#define SYSRING_SIZE 64
+
+/* A system call submitted through the ring. */
+struct sysring_sqe {
+	uint32_t nr;            /* System call number (SYS_*). */
+	uint64_t args[3];       /* Arguments, as for the system call. */
+	uint64_t user_data;     /* Copied to the matching completion. */
+};
+
+/* The result of a submitted system call. */
+struct sysring_cqe {
+	uint64_t user_data;     /* From the submission. */
+	int64_t res;            /* Return value, or -1 if the system call
+	                           cannot be submitted through the ring. */
+};
+
+/* A submission/completion ring in user memory.  The process fills
+ * SQ entries and advances SQ_TAIL; sysring_enter() runs every
+ * pending submission in order, advancing SQ_HEAD, and posts one
+ * completion per submission at CQ_TAIL.  The process consumes
+ * completions by advancing CQ_HEAD.  Indexes run freely and are
+ * reduced modulo SYSRING_SIZE. */
+struct sysring {
+	uint32_t sq_head, sq_tail;
+	uint32_t cq_head, cq_tail;
+	struct sysring_sqe sq[SYSRING_SIZE];
+	struct sysring_cqe cq[SYSRING_SIZE];
+};
+
+#endif /* lib/sysring.h */
@@ -4,6 +4,9 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <memstat.h>
+#include <rusage.h>
+#include <sysring.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -50,6 +53,12 @@ bool isdir(int fd);
 int inumber(int fd);
 int symlink(const char *target, const char *linkpath);
 
+/* Extras. */
+int memstat(struct memstat *ms);
+int sysring_enter(struct sysring *ring);
+pid_t spawn(const char *file, char *const argv[], const int fds[], int fd_cnt);
+int getrusage(int who, struct rusage *usage);
+
 static inline void *get_phys_addr(void *user_addr)
 {
 	void *pa;
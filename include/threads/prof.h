@@ -0,0 +1,34 @@
+#ifndef THREADS_PROF_H
+#define THREADS_PROF_H
+
+#include <stdbool.h>
+#include "threads/interrupt.h"
+
+/* Sampling CPU profiler.
+
+   When requested with the -prof option, the timer interrupt
+   records the interrupted rip, the kernel call stack above it,
+   and the running thread's tid, in a histogram of distinct
+   samples.  At power off the histogram is printed to the
+   console, where utils/pintos-prof turns it into a flat profile
+   or into folded stacks for flame graphs. */
+
+/* Most samples per timer tick.  The timer can then fire up to
+   TIMER_FREQ * PROF_RATE_MAX times per second. */
+#define PROF_RATE_MAX 10
+
+/* -prof[=HZ]: Sample HZ times per second, or once per timer
+   tick if HZ is not given. */
+extern bool prof_requested;
+extern unsigned prof_hz;
+
+/* True while sampling.  The timer interrupt then fires PROF_RATE
+   times per timer tick. */
+extern bool prof_enabled;
+extern unsigned prof_rate;
+
+void prof_init (void);
+void prof_sample (const struct intr_frame *);
+void prof_dump (void);
+
+#endif /* threads/prof.h */
@@ -41,5 +41,13 @@
 #define PTE_U 0x4                        /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20                       /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40                       /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80                      /* 1=2 MB page (PDEs only). */
+
+/* A PDE with PTE_PS set maps a whole 2 MB "huge" page directly,
+   without a page table below it. */
+#define HUGE_PGSIZE (1UL << PDXSHIFT)        /* Bytes in a huge page. */
+#define HUGE_PGCNT (HUGE_PGSIZE / PGSIZE)    /* Pages in a huge page. */
+#define HUGE_PGMASK (HUGE_PGSIZE - 1)        /* Huge page offset bits. */
+#define is_huge_pte(pte) ((*(pte) & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS))
 
 #endif /* threads/pte.h */
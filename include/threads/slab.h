@@ -0,0 +1,24 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <stddef.h>
+
+/* Object caches.
+
+   A cache hands out objects of one fixed size, packed into pages
+   with no rounding beyond 8-byte alignment.  An optional
+   constructor brings each object into its initial state once,
+   when its page is added to the cache; objects must be returned
+   to the cache in that state. */
+
+struct kmem_cache;
+typedef void kmem_ctor_func (void *obj);
+
+struct kmem_cache *kmem_cache_create (const char *name, size_t size,
+		kmem_ctor_func *ctor);
+void *kmem_cache_alloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *);
+struct kmem_cache *kmem_cache_of (const void *);
+void kmem_print_stats (void);
+
+#endif /* threads/slab.h */
@@ -3,6 +3,7 @@
 
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /* A counting semaphore. */
 struct semaphore
@@ -10,9 +11,18 @@ struct semaphore
 	unsigned value;		 /* Current value. */
 	struct list waiters; /* List of waiting threads. */
 	int priority;
+	struct sync_stats *stats; /* Contention statistics, or null. */
 };
 
-void sema_init(struct semaphore *, unsigned value);
+/* -lockstat: 락과 세마포어의 경합 통계를 모을지 여부. */
+extern bool lockstat_enabled;
+
+/* 이름은 통계를 묶는 단위다.  이름을 따로 주지 않으면 초기화 함수에
+   넘긴 식(예: "&filesys_lock")이 이름이 된다. */
+#define sema_init(SEMA, VALUE) sema_init_named(SEMA, VALUE, #SEMA)
+#define lock_init(LOCK) lock_init_named(LOCK, #LOCK)
+
+void sema_init_named(struct semaphore *, unsigned value, const char *name);
 void sema_down(struct semaphore *);
 bool sema_try_down(struct semaphore *);
 void sema_up(struct semaphore *);
@@ -23,13 +33,15 @@ struct lock
 {
 	struct thread *holder;		/* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	uint64_t acquired_tsc;		/* When the holder got it, for -lockstat. */
 };
 
-void lock_init(struct lock *);
+void lock_init_named(struct lock *, const char *name);
 void lock_acquire(struct lock *);
 bool lock_try_acquire(struct lock *);
 void lock_release(struct lock *);
 bool lock_held_by_current_thread(const struct lock *);
+void synch_print_stats(void);
 
 /* Condition variable. */
 struct condition
@@ -2,7 +2,10 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <hash.h>
 #include <list.h>
+#include <rbtree.h>
+#include <rusage.h>
 #include <stdint.h>
 #include "threads/interrupt.h"
 #include "threads/synch.h"
@@ -10,8 +13,10 @@
 #include "vm/vm.h"
 #endif
 /* --------------------[project2]-----------------------*/
-#define FDT_PAGES 3
-#define FDCOUNT_LIMIT FDT_PAGES * (1 << 9)
+#define FDT_INIT_CNT 16              /* 처음 만드는 fdt의 칸 수 */
+#define FDCOUNT_LIMIT (3 << 9)       /* fdt가 커질 수 있는 최대 칸 수 */
+#define FD_MAP_BITS 64               /* fd 비트맵 한 워드의 비트 수 */
+#define FD_MAP_WORDS(CNT) (((CNT) + FD_MAP_BITS - 1) / FD_MAP_BITS)
 /* --------------------[project2]-----------------------*/
 
 /* States in a thread's life cycle. */
@@ -37,12 +42,29 @@ typedef int tid_t;
 void thread_sleep(int64_t ticks);
 static struct list ready_list;
 
-static struct list sleep_list;
 void update_next_to_wake(int64_t local_ticks);
 int64_t get_next_to_wakeup(void);
 
 /*----------------[project1]-------------------*/
 
+/*----------------[project2]-------------------*/
+/* 자식 프로세스의 종료 상태 레코드.
+ * struct thread와 따로 할당되어, 자식은 종료하자마자 스레드 페이지를 반납하고
+ * 부모는 나중에 이 레코드에서 종료 상태를 읽는다. 부모와 자식이 참조를 하나씩
+ * 가지며, 둘 다 놓으면 해제된다. */
+struct exit_record
+{
+	tid_t tid;					/* 자식의 tid, 부모의 children 해시 키 */
+	int exit_status;			/* 자식의 종료 상태 */
+	bool fork_failed;			/* fork 복제에 실패했는지 */
+	int ref_cnt;				/* 참조 수 */
+	struct semaphore fork_sema; /* fork 복제가 끝나면 up */
+	struct semaphore wait_sema; /* 자식이 종료하면 up */
+	struct rusage rusage;		/* 자식과 그 자손이 쓴 자원, 종료할 때 채운다 */
+	struct hash_elem elem;		/* 부모의 children 해시 원소 */
+};
+/*----------------[project2]-------------------*/
+
 /* A kernel thread or user process.
  *
  * Each thread structure is stored in its own 4 kB page.  The
@@ -113,6 +135,7 @@ struct thread
 
 	/* local tick */
 	int64_t wake_up_tick;
+	struct rb_node sleep_elem; /* sleep_tree의 노드 */
 
 	/*----------------[project1]-------------------*/
 	/* priority donaion 관련 element 추가 */
@@ -124,22 +147,21 @@ struct thread
 
 	/*----------------[project2]-------------------*/
 	/* parent-children hierachy */
-	struct thread *parent_pd; 
-	struct list_elem child_elem;
-	struct list children_list;
-
-	struct semaphore wait_sema;
-	struct semaphore fork_sema;
-	struct semaphore free_sema;
+	struct hash children;			/* 자식들의 exit_record, tid로 찾는다 */
+	bool has_children;				/* children 해시를 초기화했는지 */
+	struct exit_record *exit_rec;	/* 부모에게 남길 종료 상태 레코드 */
 	int exit_status;
 
 	struct intr_frame parent_if;
 
-	struct file **fdt;
-	int next_fd;
+	struct file **fdt; /* fd_cap칸짜리 fdt, 모자라면 두 배로 늘린다 */
+	uint64_t *fd_map;  /* 사용 중인 fd의 비트맵 */
+	int fd_cap;        /* fdt의 칸 수 */
 	struct file *running;
-	int stdin_count;
-	int stdout_count;
+
+	/* 자원 사용량 */
+	struct rusage rusage;		 /* 이 스레드가 쓴 자원 */
+	struct rusage child_rusage;	 /* wait()으로 거둔 자식들이 쓴 자원 */
 	/*----------------[project2]-------------------*/
 #ifdef USERPROG
 	/* Owned by userprog/process.c. */
@@ -163,11 +185,12 @@ extern bool thread_mlfqs;
 void thread_init(void);
 void thread_start(void);
 
-void thread_tick(void);
+void thread_tick(bool user);
 void thread_print_stats(void);
 
 typedef void thread_func(void *aux);
 tid_t thread_create(const char *name, int priority, thread_func *, void *);
+tid_t thread_create_child(const char *name, int priority, thread_func *, void *);
 
 void thread_block(void);
 void thread_unblock(struct thread *);
@@ -191,6 +214,10 @@ void do_iret(struct intr_frame *tf);
 
 void thread_sleep(int64_t);
 void thread_wakeup(int64_t);
+struct exit_record *thread_get_child(tid_t tid);
+void thread_forget_child(struct exit_record *rec);
+void thread_release_record(struct exit_record *rec);
+void thread_release_children(void);
 void update_next_to_wake(int64_t local_ticks);
 int64_t get_next_to_wakeup(void);
 void test_max_priority(void);
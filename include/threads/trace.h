@@ -0,0 +1,47 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Kernel event tracing.
+
+   Static tracepoints throughout the kernel record timestamped
+   events into a ring buffer when tracing was requested with the
+   -trace option.  At power off the recorded events are written
+   out in the Chrome trace event format, for chrome://tracing or
+   Perfetto.  When tracing is off, a tracepoint costs a load and
+   a branch that is predicted not taken. */
+
+/* Traced events, and what their two arguments are. */
+enum trace_event {
+	TRACE_SWITCH,               /* Context switch: tid of next thread. */
+	TRACE_PAGE_FAULT,           /* Page fault: address, rip. */
+	TRACE_SYSCALL_ENTER,        /* System call: number. */
+	TRACE_SYSCALL_EXIT,         /* System call return: number, result. */
+	TRACE_DISK_SUBMIT,          /* Disk request: sector, true if write. */
+	TRACE_DISK_COMPLETE,        /* Disk request done: sector, true if write. */
+	TRACE_LOCK_WAIT,            /* Lock is held: lock, holder's tid. */
+	TRACE_LOCK_ACQUIRED,        /* Waited-for lock is ours: lock. */
+	TRACE_EVENT_CNT
+};
+
+/* Records EVENT with arguments A and B, if tracing is on. */
+#define TRACE(EVENT, A, B)                                              \
+	do {                                                            \
+		if (__builtin_expect (trace_enabled, 0))                \
+			trace_record (EVENT, (uint64_t) (A), (uint64_t) (B)); \
+	} while (0)
+
+/* -trace[=FILE]: Trace kernel events, and write them to FILE
+   instead of the console? */
+extern bool trace_requested;
+extern const char *trace_file;
+
+extern bool trace_enabled;
+
+void trace_init (void);
+void trace_record (enum trace_event, uint64_t a, uint64_t b);
+void trace_dump (void);
+
+#endif /* threads/trace.h */
@@ -3,14 +3,33 @@
 
 #include "threads/thread.h"
 
+#define SPAWN_ARGC_MAX 64 /* spawn이 받는 인자의 최대 개수 */
+#define SPAWN_FD_MAX 64   /* spawn이 다시 배치하는 fd의 최대 개수 */
+
+/* spawn으로 만들 자식에게 넘기는 정보. 한 페이지에 담고, 남은 공간에 문자열을 둔다.
+   자식이 프로그램을 다 올릴 때까지 부모가 기다리므로 그동안만 살아 있으면 된다. */
+struct spawn_args
+{
+    struct thread *parent;
+    char *path;                       /* 실행할 파일 */
+    int argc;
+    char *argv[SPAWN_ARGC_MAX + 1];   /* NULL로 끝나는 인자 */
+    const int *fds;                   /* NULL이면 부모의 fd를 모두 물려준다 */
+    int fd_cnt;                       /* 자식의 fd i는 부모의 fd fds[i], -1이면 닫힘 */
+    int fd_buf[SPAWN_FD_MAX];         /* fds가 가리키는 공간 */
+};
+
 tid_t process_create_initd(const char *file_name);
 tid_t process_fork(const char *name, struct intr_frame *if_ UNUSED);
 int process_exec(void *f_name);
+tid_t process_spawn(struct spawn_args *args);
 int process_wait(tid_t);
 void process_exit(void);
 void process_activate(struct thread *next);
+
+/* -hp: Map large zero-filled user segments with 2 MB pages? */
+extern bool user_huge_pages;
 /* project2 */
 void argument_stack(char **parse, int count, struct intr_frame *if_);
-struct thread *get_child_process(int pid);
 
 #endif /* userprog/process.h */
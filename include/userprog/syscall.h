@@ -1,6 +1,10 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <stdbool.h>
+
+struct thread;
+
 void syscall_init(void);
 /* project2 */
 void check_address(const void *addr);
@@ -9,4 +13,7 @@ struct lock filesys_lock;
 
 struct file *process_get_file(int fd);
 void process_close_file(int fd);
+bool process_fdt_reserve(struct thread *t, int cnt);
+int process_next_fd(struct thread *t, int fd);
+bool process_is_std_file(struct file *f);
 #endif /* userprog/syscall.h */
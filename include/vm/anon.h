@@ -4,7 +4,24 @@
 struct page;
 enum vm_type;
 
+/* Where the contents of an evicted anonymous page are kept. */
+enum anon_swap {
+	ANON_RESIDENT,              /* Not evicted. */
+	ANON_FILLED,                /* Every word equals FILL. */
+	ANON_ZSWAP,                 /* Compressed at ZDATA. */
+	ANON_DISK,                  /* In SWAP_SLOT. */
+};
+
 struct anon_page {
+	enum anon_swap where;
+	size_t swap_slot;           /* Slot holding a copy, or BITMAP_ERROR. */
+	union {
+		uint64_t fill;          /* ANON_FILLED. */
+		struct {                /* ANON_ZSWAP. */
+			void *zdata;
+			size_t zsize;
+		};
+	};
 };
 
 void vm_anon_init (void);
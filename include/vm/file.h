@@ -6,7 +6,13 @@
 struct page;
 enum vm_type;
 
+/* A page of FILE: READ_BYTES bytes at offset OFS followed by
+ * ZERO_BYTES zeroes.  FILE belongs to the page's vm_region. */
 struct file_page {
+	struct file *file;
+	off_t ofs;
+	size_t read_bytes;
+	size_t zero_bytes;
 };
 
 void vm_file_init (void);
@@ -1,7 +1,10 @@
 #ifndef VM_VM_H
 #define VM_VM_H
 #include <stdbool.h>
+#include <hash.h>
+#include <list.h>
 #include "threads/palloc.h"
+#include "filesys/off_t.h"
 
 enum vm_type {
 	/* page not initialized */
@@ -46,6 +49,10 @@ struct page {
 	struct frame *frame;   /* Back reference for frame */
 
 	/* Your implementation */
+	struct hash_elem spt_elem;  /* Element in supplemental_page_table. */
+	bool writable;              /* May the user write to this page? */
+	uint64_t *pml4;             /* Page map of the owning process. */
+	struct list_elem rmap_elem; /* Element in frame's mappers list. */
 
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -63,6 +70,21 @@ struct page {
 struct frame {
 	void *kva;
 	struct page *page;
+
+	/* Reverse map: every page that maps this frame, each naming its
+	 * own (pml4, va), so that eviction and the dirty and accessed
+	 * bit checks visit only the mappers of the frame.  PAGE is one
+	 * of them.  Protected by the frame table lock. */
+	struct list mappers;
+	size_t mapcount;            /* Number of mappers. */
+	struct list_elem ft_elem;   /* Element in the frame table. */
+
+	/* Text cache key, if the frame holds a shared read-only page of
+	 * a file.  INODE is a null pointer otherwise. */
+	struct inode *inode;
+	off_t ofs;
+	size_t read_bytes;
+	struct hash_elem tc_elem;   /* Element in the text cache. */
 };
 
 /* The function table for page operations.
@@ -85,8 +107,42 @@ struct page_operations {
  * We don't want to force you to obey any specific design for this struct.
  * All designs up to you for this. */
 struct supplemental_page_table {
+	struct hash pages;          /* All pages, keyed by va. */
+	struct list regions;        /* File-backed regions, see vm_region. */
+};
+
+/* Auxiliary data of a page whose contents are read from a file on
+ * its first fault: READ_BYTES bytes at offset OFS of FILE, followed
+ * by ZERO_BYTES zeroes. */
+struct lazy_load_aux {
+	struct file *file;
+	off_t ofs;
+	size_t read_bytes;
+	size_t zero_bytes;
 };
 
+/* A run of pages [START, END) that is loaded from one file, such as
+ * a PT_LOAD segment of the executable.  The region owns its own
+ * handle on the file and remembers the fault history that drives
+ * fault-around. */
+struct vm_region {
+	struct list_elem elem;      /* Element in supplemental_page_table. */
+	void *start;                /* First page. */
+	void *end;                  /* One past the last page. */
+	struct file *file;          /* Backing file, closed with the region. */
+
+	/* Fault-around state. */
+	size_t fa_window;           /* Current window, in pages. */
+	void *fa_start;             /* Window mapped by the last fault. */
+	void *fa_end;
+	size_t fa_prefetched;       /* Pages prefetched in that window. */
+};
+
+/* Default and upper bound of the fault-around window, in pages. */
+#define FAULT_AROUND_DEFAULT 16
+#define FAULT_AROUND_MAX 64
+extern size_t vm_fault_around_pages;
+
 #include "threads/thread.h"
 void supplemental_page_table_init (struct supplemental_page_table *spt);
 bool supplemental_page_table_copy (struct supplemental_page_table *dst,
@@ -96,6 +152,14 @@ struct page *spt_find_page (struct supplemental_page_table *spt,
 		void *va);
 bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
+struct vm_region *vm_region_create (struct supplemental_page_table *spt,
+		void *start, void *end, struct file *file);
+struct vm_region *vm_region_find (struct supplemental_page_table *spt,
+		const void *va);
+
+bool vm_frame_is_dirty (struct frame *frame);
+struct memstat;
+void vm_memstat (struct supplemental_page_table *spt, struct memstat *ms);
 
 void vm_init (void);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
@@ -0,0 +1,20 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Default limit of the compressed pool, in pages. */
+#define ZSWAP_DEFAULT_PAGES 256
+extern size_t zswap_max_pages;
+
+void zswap_init (void);
+bool zswap_same_filled (const void *kva, uint64_t *fill);
+void zswap_fill (void *kva, uint64_t fill);
+void *zswap_store (const void *kva, size_t *size);
+void zswap_load (const void *data, size_t size, void *kva);
+void zswap_free (void *data, size_t size);
+void zswap_count_disk_write (void);
+void zswap_print_stats (void);
+
+#endif  /* VM_ZSWAP_H */
@@ -12,12 +12,12 @@
 #define list_elem_to_hash_elem(LIST_ELEM)                       \
 	list_entry(LIST_ELEM, struct hash_elem, list_elem)
 
-static struct list *find_bucket (struct hash *, struct hash_elem *);
-static struct hash_elem *find_elem (struct hash *, struct list *,
-		struct hash_elem *);
-static void insert_elem (struct hash *, struct list *, struct hash_elem *);
+static struct list *find_bucket (struct hash *, uint64_t hash);
+static struct hash_elem *find_elem (struct hash *, struct hash_elem *);
+static void insert_elem (struct hash *, struct hash_elem *);
 static void remove_elem (struct hash *, struct hash_elem *);
 static void rehash (struct hash *);
+static void migrate (struct hash *, size_t cnt);
 
 /* Initializes hash table H to compute hash values using HASH and
    compare hash elements using LESS, given auxiliary data AUX. */
@@ -27,6 +27,9 @@ hash_init (struct hash *h,
 	h->elem_cnt = 0;
 	h->bucket_cnt = 4;
 	h->buckets = malloc (sizeof *h->buckets * h->bucket_cnt);
+	h->old_buckets = NULL;
+	h->old_bucket_cnt = 0;
+	h->migrate_idx = 0;
 	h->hash = hash;
 	h->less = less;
 	h->aux = aux;
@@ -51,6 +54,10 @@ void
 hash_clear (struct hash *h, hash_action_func *destructor) {
 	size_t i;
 
+	/* Finish any migration first, so that every element is in
+	   H->buckets. */
+	migrate (h, h->old_bucket_cnt);
+
 	for (i = 0; i < h->bucket_cnt; i++) {
 		struct list *bucket = &h->buckets[i];
 
@@ -81,6 +88,7 @@ void
 hash_destroy (struct hash *h, hash_action_func *destructor) {
 	if (destructor != NULL)
 		hash_clear (h, destructor);
+	free (h->old_buckets);
 	free (h->buckets);
 }
 
@@ -90,11 +98,12 @@ hash_destroy (struct hash *h, hash_action_func *destructor) {
    without inserting NEW. */
 struct hash_elem *
 hash_insert (struct hash *h, struct hash_elem *new) {
-	struct list *bucket = find_bucket (h, new);
-	struct hash_elem *old = find_elem (h, bucket, new);
+	struct hash_elem *old;
 
+	new->hash = h->hash (new, h->aux);
+	old = find_elem (h, new);
 	if (old == NULL)
-		insert_elem (h, bucket, new);
+		insert_elem (h, new);
 
 	rehash (h);
 
@@ -105,12 +114,13 @@ hash_insert (struct hash *h, struct hash_elem *new) {
    already in the table, which is returned. */
 struct hash_elem *
 hash_replace (struct hash *h, struct hash_elem *new) {
-	struct list *bucket = find_bucket (h, new);
-	struct hash_elem *old = find_elem (h, bucket, new);
+	struct hash_elem *old;
 
+	new->hash = h->hash (new, h->aux);
+	old = find_elem (h, new);
 	if (old != NULL)
 		remove_elem (h, old);
-	insert_elem (h, bucket, new);
+	insert_elem (h, new);
 
 	rehash (h);
 
@@ -121,7 +131,8 @@ hash_replace (struct hash *h, struct hash_elem *new) {
    null pointer if no equal element exists in the table. */
 struct hash_elem *
 hash_find (struct hash *h, struct hash_elem *e) {
-	return find_elem (h, find_bucket (h, e), e);
+	e->hash = h->hash (e, h->aux);
+	return find_elem (h, e);
 }
 
 /* Finds, removes, and returns an element equal to E in hash
@@ -133,7 +144,10 @@ hash_find (struct hash *h, struct hash_elem *e) {
    responsibility to deallocate them. */
 struct hash_elem *
 hash_delete (struct hash *h, struct hash_elem *e) {
-	struct hash_elem *found = find_elem (h, find_bucket (h, e), e);
+	struct hash_elem *found;
+
+	e->hash = h->hash (e, h->aux);
+	found = find_elem (h, e);
 	if (found != NULL) {
 		remove_elem (h, found);
 		rehash (h);
@@ -149,18 +163,15 @@ hash_delete (struct hash *h, struct hash_elem *e) {
    undefined behavior, whether done from ACTION or elsewhere. */
 void
 hash_apply (struct hash *h, hash_action_func *action) {
-	size_t i;
+	struct hash_iterator i;
+	struct hash_elem *e, *next;
 
 	ASSERT (action != NULL);
 
-	for (i = 0; i < h->bucket_cnt; i++) {
-		struct list *bucket = &h->buckets[i];
-		struct list_elem *elem, *next;
-
-		for (elem = list_begin (bucket); elem != list_end (bucket); elem = next) {
-			next = list_next (elem);
-			action (list_elem_to_hash_elem (elem), h->aux);
-		}
+	hash_first (&i, h);
+	for (e = hash_next (&i); e != NULL; e = next) {
+		next = hash_next (&i);
+		action (e, h->aux);
 	}
 }
 
@@ -203,9 +214,17 @@ struct hash_elem *
 hash_next (struct hash_iterator *i) {
 	ASSERT (i != NULL);
 
+	struct hash *h = i->hash;
+
 	i->elem = list_elem_to_hash_elem (list_next (&i->elem->list_elem));
 	while (i->elem == list_elem_to_hash_elem (list_end (i->bucket))) {
-		if (++i->bucket >= i->hash->buckets + i->hash->bucket_cnt) {
+		/* Visit the buckets of H->buckets, then the buckets of
+		   H->old_buckets that have not been migrated yet. */
+		++i->bucket;
+		if (i->bucket == h->buckets + h->bucket_cnt && h->old_buckets != NULL)
+			i->bucket = h->old_buckets + h->migrate_idx;
+		if (i->bucket == h->buckets + h->bucket_cnt
+				|| i->bucket == h->old_buckets + h->old_bucket_cnt) {
 			i->elem = NULL;
 			break;
 		}
@@ -273,30 +292,62 @@ hash_string (const char *s_) {
 /* Returns a hash of integer I. */
 uint64_t
 hash_int (int i) {
-	return hash_bytes (&i, sizeof i);
+	return hash_uint64 ((unsigned) i);
+}
+
+/* Returns a hash of X.  This is the 64-bit finalizer of
+   MurmurHash3: a few multiplies and shifts that make every bit
+   of X affect every bit of the result, which is much cheaper
+   than hash_bytes() on a word-sized key such as a pointer. */
+uint64_t
+hash_uint64 (uint64_t x) {
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return x;
 }
 
-/* Returns the bucket in H that E belongs in. */
+/* Returns the bucket in H's current bucket array for hash value
+   HASH. */
 static struct list *
-find_bucket (struct hash *h, struct hash_elem *e) {
-	size_t bucket_idx = h->hash (e, h->aux) & (h->bucket_cnt - 1);
-	return &h->buckets[bucket_idx];
+find_bucket (struct hash *h, uint64_t hash) {
+	return &h->buckets[hash & (h->bucket_cnt - 1)];
 }
 
-/* Searches BUCKET in H for a hash element equal to E.  Returns
-   it if found or a null pointer otherwise. */
+/* Searches BUCKET in H for a hash element equal to E, whose hash
+   value must already be cached.  Returns it if found or a null
+   pointer otherwise. */
 static struct hash_elem *
-find_elem (struct hash *h, struct list *bucket, struct hash_elem *e) {
+search_bucket (struct hash *h, struct list *bucket, struct hash_elem *e) {
 	struct list_elem *i;
 
 	for (i = list_begin (bucket); i != list_end (bucket); i = list_next (i)) {
 		struct hash_elem *hi = list_elem_to_hash_elem (i);
-		if (!h->less (hi, e, h->aux) && !h->less (e, hi, h->aux))
+		if (hi->hash == e->hash
+				&& !h->less (hi, e, h->aux) && !h->less (e, hi, h->aux))
 			return hi;
 	}
 	return NULL;
 }
 
+/* Searches H for a hash element equal to E, whose hash value
+   must already be cached.  Returns it if found or a null pointer
+   otherwise. */
+static struct hash_elem *
+find_elem (struct hash *h, struct hash_elem *e) {
+	struct hash_elem *found = search_bucket (h, find_bucket (h, e->hash), e);
+
+	/* E may still be in a bucket that has not been migrated. */
+	if (found == NULL && h->old_buckets != NULL) {
+		size_t idx = e->hash & (h->old_bucket_cnt - 1);
+		if (idx >= h->migrate_idx)
+			found = search_bucket (h, &h->old_buckets[idx], e);
+	}
+	return found;
+}
+
 /* Returns X with its lowest-order bit set to 1 turned off. */
 static inline size_t
 turn_off_least_1bit (size_t x) {
@@ -314,21 +365,59 @@ is_power_of_2 (size_t x) {
 #define BEST_ELEMS_PER_BUCKET 2 /* Ideal elems/bucket. */
 #define MAX_ELEMS_PER_BUCKET  4 /* Elems/bucket > 4: increase # of buckets. */
 
-/* Changes the number of buckets in hash table H to match the
-   ideal.  This function can fail because of an out-of-memory
-   condition, but that'll just make hash accesses less efficient;
-   we can still continue. */
+/* Number of old buckets migrated per insertion or deletion.  A
+   migration started when the table grows finishes well before
+   the table can need to grow again. */
+#define MIGRATE_STEP 2
+
+/* Moves up to CNT buckets of H's old bucket array into the
+   current one, and frees the old array once it is empty. */
+static void
+migrate (struct hash *h, size_t cnt) {
+	if (h->old_buckets == NULL)
+		return;
+
+	while (cnt-- > 0 && h->migrate_idx < h->old_bucket_cnt) {
+		struct list *old_bucket = &h->old_buckets[h->migrate_idx++];
+
+		while (!list_empty (old_bucket)) {
+			struct list_elem *elem = list_pop_front (old_bucket);
+			uint64_t hash = list_elem_to_hash_elem (elem)->hash;
+			list_push_front (find_bucket (h, hash), elem);
+		}
+	}
+
+	if (h->migrate_idx == h->old_bucket_cnt) {
+		free (h->old_buckets);
+		h->old_buckets = NULL;
+		h->old_bucket_cnt = 0;
+		h->migrate_idx = 0;
+	}
+}
+
+/* Advances any migration in progress in hash table H, then
+   starts a new one if the number of elements per bucket has left
+   the range MIN_ELEMS_PER_BUCKET...MAX_ELEMS_PER_BUCKET.  This
+   function can fail because of an out-of-memory condition, but
+   that'll just make hash accesses less efficient; we can still
+   continue. */
 static void
 rehash (struct hash *h) {
-	size_t old_bucket_cnt, new_bucket_cnt;
-	struct list *new_buckets, *old_buckets;
+	size_t new_bucket_cnt;
+	struct list *new_buckets;
 	size_t i;
 
 	ASSERT (h != NULL);
 
-	/* Save old bucket info for later use. */
-	old_buckets = h->buckets;
-	old_bucket_cnt = h->bucket_cnt;
+	migrate (h, MIGRATE_STEP);
+	if (h->old_buckets != NULL)
+		return;
+
+	/* Leave the table alone while the load is within bounds. */
+	if (h->elem_cnt <= h->bucket_cnt * MAX_ELEMS_PER_BUCKET
+			&& (h->bucket_cnt <= 4
+				|| h->elem_cnt >= h->bucket_cnt * MIN_ELEMS_PER_BUCKET))
+		return;
 
 	/* Calculate the number of buckets to use now.
 	   We want one bucket for about every BEST_ELEMS_PER_BUCKET.
@@ -341,7 +430,7 @@ rehash (struct hash *h) {
 		new_bucket_cnt = turn_off_least_1bit (new_bucket_cnt);
 
 	/* Don't do anything if the bucket count wouldn't change. */
-	if (new_bucket_cnt == old_bucket_cnt)
+	if (new_bucket_cnt == h->bucket_cnt)
 		return;
 
 	/* Allocate new buckets and initialize them as empty. */
@@ -355,34 +444,22 @@ rehash (struct hash *h) {
 	for (i = 0; i < new_bucket_cnt; i++)
 		list_init (&new_buckets[i]);
 
-	/* Install new bucket info. */
+	/* Install new bucket info.  The elements move over a few
+	   buckets at a time, in this and later calls. */
+	h->old_buckets = h->buckets;
+	h->old_bucket_cnt = h->bucket_cnt;
+	h->migrate_idx = 0;
 	h->buckets = new_buckets;
 	h->bucket_cnt = new_bucket_cnt;
-
-	/* Move each old element into the appropriate new bucket. */
-	for (i = 0; i < old_bucket_cnt; i++) {
-		struct list *old_bucket;
-		struct list_elem *elem, *next;
-
-		old_bucket = &old_buckets[i];
-		for (elem = list_begin (old_bucket);
-				elem != list_end (old_bucket); elem = next) {
-			struct list *new_bucket
-				= find_bucket (h, list_elem_to_hash_elem (elem));
-			next = list_next (elem);
-			list_remove (elem);
-			list_push_front (new_bucket, elem);
-		}
-	}
-
-	free (old_buckets);
+	migrate (h, MIGRATE_STEP);
 }
 
-/* Inserts E into BUCKET (in hash table H). */
+/* Inserts E, whose hash value must already be cached, into hash
+   table H. */
 static void
-insert_elem (struct hash *h, struct list *bucket, struct hash_elem *e) {
+insert_elem (struct hash *h, struct hash_elem *e) {
 	h->elem_cnt++;
-	list_push_front (bucket, &e->list_elem);
+	list_push_front (find_bucket (h, e->hash), &e->list_elem);
 }
 
 /* Removes E from hash table H. */
@@ -392,3 +469,219 @@ remove_elem (struct hash *h, struct hash_elem *e) {
 	list_remove (&e->list_elem);
 }
 
+
+/* Open-addressing hash table.
+
+   Elements live directly in an array of slots, each caching the
+   element's hash value.  An element is stored at the first free
+   slot at or after its home slot (its hash modulo the number of
+   slots), with Robin Hood probing: an element being inserted
+   takes over the slot of any element that is closer to its own
+   home, which then continues the probe instead.  This keeps the
+   probe sequences short and even, and lets a failed lookup stop
+   as soon as it reaches an element closer to home than the key
+   would be.  Deletion shifts the following elements of the run
+   back by one slot instead of leaving a tombstone. */
+
+/* Number of slots in a new table. */
+#define OHASH_MIN_SLOTS 8
+
+/* Returns how far the element with hash value HASH sits past its
+   home slot when it is in slot IDX of H. */
+static inline size_t
+probe_dist (const struct ohash *h, uint64_t hash, size_t idx) {
+	return (idx - hash) & (h->slot_cnt - 1);
+}
+
+/* Stores E, with hash value HASH, in H, which must have a free
+   slot and must not already contain an element equal to E. */
+static void
+ohash_place (struct ohash *h, uint64_t hash, struct hash_elem *e) {
+	size_t mask = h->slot_cnt - 1;
+	size_t idx = hash & mask;
+	size_t dist = 0;
+
+	for (;; idx = (idx + 1) & mask, dist++) {
+		struct ohash_slot *slot = &h->slots[idx];
+		size_t slot_dist;
+
+		if (slot->elem == NULL) {
+			slot->hash = hash;
+			slot->elem = e;
+			return;
+		}
+
+		/* Take the slot from an element closer to its home. */
+		slot_dist = probe_dist (h, slot->hash, idx);
+		if (slot_dist < dist) {
+			struct ohash_slot displaced = *slot;
+			slot->hash = hash;
+			slot->elem = e;
+			hash = displaced.hash;
+			e = displaced.elem;
+			dist = slot_dist;
+		}
+	}
+}
+
+/* Changes the number of slots in H to SLOT_CNT, a power of 2 that
+   is greater than the number of elements.  Returns false if
+   memory cannot be allocated, leaving H unchanged. */
+static bool
+ohash_resize (struct ohash *h, size_t slot_cnt) {
+	struct ohash_slot *old_slots = h->slots;
+	size_t old_slot_cnt = h->slot_cnt;
+	size_t i;
+
+	h->slots = calloc (slot_cnt, sizeof *h->slots);
+	if (h->slots == NULL) {
+		h->slots = old_slots;
+		return false;
+	}
+	h->slot_cnt = slot_cnt;
+
+	for (i = 0; i < old_slot_cnt; i++)
+		if (old_slots[i].elem != NULL)
+			ohash_place (h, old_slots[i].hash, old_slots[i].elem);
+	free (old_slots);
+	return true;
+}
+
+/* Returns the index of the slot in H that holds an element equal
+   to E, whose hash value is HASH, or -1 if there is none. */
+static ptrdiff_t
+ohash_lookup (struct ohash *h, uint64_t hash, struct hash_elem *e) {
+	size_t mask = h->slot_cnt - 1;
+	size_t idx = hash & mask;
+	size_t dist = 0;
+
+	for (;; idx = (idx + 1) & mask, dist++) {
+		struct ohash_slot *slot = &h->slots[idx];
+
+		if (slot->elem == NULL || probe_dist (h, slot->hash, idx) < dist)
+			return -1;
+		if (slot->hash == hash && h->equal (slot->elem, e, h->aux))
+			return idx;
+	}
+}
+
+/* Initializes open-addressing hash table H to compute hash values
+   using HASH and compare hash elements using EQUAL, given
+   auxiliary data AUX. */
+bool
+ohash_init (struct ohash *h,
+		hash_hash_func *hash, hash_equal_func *equal, void *aux) {
+	h->elem_cnt = 0;
+	h->slot_cnt = OHASH_MIN_SLOTS;
+	h->slots = calloc (h->slot_cnt, sizeof *h->slots);
+	h->hash = hash;
+	h->equal = equal;
+	h->aux = aux;
+	return h->slots != NULL;
+}
+
+/* Removes all the elements from H, calling DESTRUCTOR for each
+   of them if it is non-null, with the same restrictions as
+   hash_clear(). */
+void
+ohash_clear (struct ohash *h, hash_action_func *destructor) {
+	size_t i;
+
+	for (i = 0; i < h->slot_cnt; i++) {
+		struct hash_elem *e = h->slots[i].elem;
+
+		h->slots[i].elem = NULL;
+		if (e != NULL && destructor != NULL)
+			destructor (e, h->aux);
+	}
+	h->elem_cnt = 0;
+}
+
+/* Destroys H, first calling DESTRUCTOR for each element if it is
+   non-null, as hash_destroy() does. */
+void
+ohash_destroy (struct ohash *h, hash_action_func *destructor) {
+	if (destructor != NULL)
+		ohash_clear (h, destructor);
+	free (h->slots);
+}
+
+/* Inserts NEW into H and returns a null pointer, if no equal
+   element is already in the table.  If an equal element is
+   already in the table, returns it without inserting NEW.  If
+   the table is full and cannot grow, returns NEW without
+   inserting it. */
+struct hash_elem *
+ohash_insert (struct ohash *h, struct hash_elem *new) {
+	uint64_t hash = h->hash (new, h->aux);
+	ptrdiff_t idx = ohash_lookup (h, hash, new);
+
+	if (idx >= 0)
+		return h->slots[idx].elem;
+
+	/* Keep the table at most 3/4 full.  Failing to grow only makes
+	   probes longer, until no slot is left. */
+	if ((h->elem_cnt + 1) * 4 > h->slot_cnt * 3
+			&& !ohash_resize (h, h->slot_cnt * 2)
+			&& h->elem_cnt + 1 == h->slot_cnt)
+		return new;
+
+	ohash_place (h, hash, new);
+	h->elem_cnt++;
+	return NULL;
+}
+
+/* Finds and returns an element equal to E in H, or a null pointer
+   if no equal element exists in the table. */
+struct hash_elem *
+ohash_find (struct ohash *h, struct hash_elem *e) {
+	ptrdiff_t idx = ohash_lookup (h, h->hash (e, h->aux), e);
+	return idx >= 0 ? h->slots[idx].elem : NULL;
+}
+
+/* Finds, removes, and returns an element equal to E in H.
+   Returns a null pointer if no equal element existed in the
+   table. */
+struct hash_elem *
+ohash_delete (struct ohash *h, struct hash_elem *e) {
+	size_t mask = h->slot_cnt - 1;
+	ptrdiff_t idx = ohash_lookup (h, h->hash (e, h->aux), e);
+	struct hash_elem *found;
+	size_t i, next;
+
+	if (idx < 0)
+		return NULL;
+	found = h->slots[idx].elem;
+
+	/* Shift the rest of the run back, up to an empty slot or an
+	   element that is already in its home slot. */
+	for (i = idx; ; i = next) {
+		next = (i + 1) & mask;
+		if (h->slots[next].elem == NULL
+				|| probe_dist (h, h->slots[next].hash, next) == 0)
+			break;
+		h->slots[i] = h->slots[next];
+	}
+	h->slots[i].elem = NULL;
+	h->elem_cnt--;
+	return found;
+}
+
+/* Calls ACTION for each element in H in arbitrary order, with the
+   same restrictions as hash_apply(). */
+void
+ohash_apply (struct ohash *h, hash_action_func *action) {
+	size_t i;
+
+	ASSERT (action != NULL);
+
+	for (i = 0; i < h->slot_cnt; i++)
+		if (h->slots[i].elem != NULL)
+			action (h->slots[i].elem, h->aux);
+}
+
+/* Returns the number of elements in H. */
+size_t
+ohash_size (struct ohash *h) {
+	return h->elem_cnt;
+}
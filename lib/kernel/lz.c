@@ -0,0 +1,186 @@
+#include "lz.h"
+#include <debug.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Compressed format.
+
+   A block is a sequence of sequences.  Each sequence starts
+   with a token byte whose high nibble is the number of literal
+   bytes that follow and whose low nibble is the length of the
+   match that comes after them, minus MIN_MATCH.  A nibble of 15
+   is continued by extra length bytes, each added to it, until
+   one is less than 255.  Then come the literals, then the match
+   offset as 2 bytes, little-endian.  The last sequence of a
+   block has literals only; it ends where the block ends. */
+
+#define MIN_MATCH 4                     /* Shortest match. */
+#define MAX_OFFSET 65535                /* Farthest match. */
+#define HASH_BITS 12                    /* log2 of hash table size. */
+
+/* Reads 4 bytes at P. */
+static inline uint32_t
+read32 (const uint8_t *p) {
+	uint32_t v;
+	memcpy (&v, p, sizeof v);
+	return v;
+}
+
+/* Hashes the 4 bytes at P into a hash table index. */
+static inline unsigned
+hash4 (const uint8_t *p) {
+	return (read32 (p) * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* Appends the extension bytes of length LEN, whose nibble was 15,
+   at *OP, unless that would pass OEND.  Returns false on
+   overflow. */
+static bool
+put_length (uint8_t **op, uint8_t *oend, size_t len) {
+	for (; len >= 255; len -= 255) {
+		if (*op >= oend)
+			return false;
+		*(*op)++ = 255;
+	}
+	if (*op >= oend)
+		return false;
+	*(*op)++ = len;
+	return true;
+}
+
+/* Appends one sequence to *OP: LIT_LEN literal bytes from LIT,
+   then, if MATCH_LEN is nonzero, a match of MATCH_LEN bytes at
+   OFFSET bytes back.  Returns false if it does not fit before
+   OEND. */
+static bool
+put_sequence (uint8_t **op, uint8_t *oend, const uint8_t *lit,
+		size_t lit_len, size_t offset, size_t match_len) {
+	uint8_t *token = (*op)++;
+	size_t ml = match_len > 0 ? match_len - MIN_MATCH : 0;
+
+	if (token >= oend)
+		return false;
+	*token = (lit_len < 15 ? lit_len : 15) << 4 | (ml < 15 ? ml : 15);
+	if (lit_len >= 15 && !put_length (op, oend, lit_len - 15))
+		return false;
+	if ((size_t) (oend - *op) < lit_len)
+		return false;
+	memcpy (*op, lit, lit_len);
+	*op += lit_len;
+
+	if (match_len == 0)
+		return true;
+	if (oend - *op < 2)
+		return false;
+	*(*op)++ = offset & 0xff;
+	*(*op)++ = offset >> 8;
+	return ml < 15 || put_length (op, oend, ml - 15);
+}
+
+/* Compresses the SRC_SIZE bytes at SRC, which must be at most
+   64 kB, into the DST_SIZE bytes at DST.  WORK must point to
+   LZ_WORK_SIZE bytes of scratch memory.  Returns the compressed
+   size, or 0 if the result does not fit in DST_SIZE bytes. */
+size_t
+lz_compress (const void *src_, size_t src_size,
+		void *dst_, size_t dst_size, void *work) {
+	const uint8_t *src = src_;
+	uint8_t *op = dst_;
+	uint8_t *oend = op + dst_size;
+	uint16_t *table = work;
+	size_t ip, anchor;
+
+	ASSERT (src_size <= 65536);
+
+	/* Table entries hold positions plus one, so that 0 means
+	   empty. */
+	memset (table, 0, LZ_WORK_SIZE);
+	ip = anchor = 0;
+	while (ip + MIN_MATCH <= src_size) {
+		unsigned h = hash4 (src + ip);
+		size_t ref = table[h];
+		size_t len;
+
+		table[h] = ip + 1;
+		if (ref == 0 || ip - (ref - 1) > MAX_OFFSET
+				|| read32 (src + ref - 1) != read32 (src + ip)) {
+			ip++;
+			continue;
+		}
+		ref--;
+
+		for (len = MIN_MATCH; ip + len < src_size
+				&& src[ref + len] == src[ip + len]; len++)
+			continue;
+		if (!put_sequence (&op, oend, src + anchor, ip - anchor,
+					ip - ref, len))
+			return 0;
+		ip += len;
+		anchor = ip;
+	}
+
+	if (!put_sequence (&op, oend, src + anchor, src_size - anchor, 0, 0))
+		return 0;
+	return op - (uint8_t *) dst_;
+}
+
+/* Reads the extension bytes of a length whose nibble was 15 from
+   *IP, which may not pass IEND, and adds them to *LEN.  Returns
+   false if the input is truncated. */
+static bool
+get_length (const uint8_t **ip, const uint8_t *iend, size_t *len) {
+	uint8_t b;
+
+	do {
+		if (*ip >= iend)
+			return false;
+		b = *(*ip)++;
+		*len += b;
+	} while (b == 255);
+	return true;
+}
+
+/* Decompresses the SRC_SIZE bytes at SRC, produced by
+   lz_compress(), into the DST_SIZE bytes at DST.  Returns the
+   decompressed size, or 0 if SRC is corrupt or does not fit. */
+size_t
+lz_decompress (const void *src_, size_t src_size,
+		void *dst_, size_t dst_size) {
+	const uint8_t *ip = src_;
+	const uint8_t *iend = ip + src_size;
+	uint8_t *dst = dst_;
+	size_t op = 0;
+
+	while (ip < iend) {
+		uint8_t token = *ip++;
+		size_t lit_len = token >> 4;
+		size_t match_len = token & 15;
+		size_t offset;
+
+		if (lit_len == 15 && !get_length (&ip, iend, &lit_len))
+			return 0;
+		if ((size_t) (iend - ip) < lit_len || dst_size - op < lit_len)
+			return 0;
+		memcpy (dst + op, ip, lit_len);
+		ip += lit_len;
+		op += lit_len;
+
+		/* The last sequence has no match. */
+		if (ip == iend)
+			break;
+		if (iend - ip < 2)
+			return 0;
+		offset = ip[0] | ip[1] << 8;
+		ip += 2;
+		if (match_len == 15 && !get_length (&ip, iend, &match_len))
+			return 0;
+		match_len += MIN_MATCH;
+		if (offset == 0 || offset > op || dst_size - op < match_len)
+			return 0;
+
+		/* Byte by byte, since the match may overlap its copy. */
+		for (; match_len > 0; match_len--, op++)
+			dst[op] = dst[op - offset];
+	}
+	return op;
+}
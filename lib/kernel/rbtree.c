@@ -0,0 +1,501 @@
+/* Red-black tree.
+
+   See rbtree.h for basic information.  The algorithms are those
+   of [CLRS] chapter 13, with null pointers in place of the
+   sentinel leaf. */
+
+#include "rbtree.h"
+#include "../debug.h"
+
+static void propagate (struct rbtree *, struct rb_node *);
+static void insert_fixup (struct rbtree *, struct rb_node *);
+static void remove_fixup (struct rbtree *, struct rb_node *,
+		struct rb_node *);
+
+/* Initializes T as an empty tree. */
+void
+rb_init (struct rbtree *t) {
+	rb_init_augmented (t, NULL);
+}
+
+/* Initializes T as an empty tree whose nodes carry augmented data
+   that UPDATE recomputes. */
+void
+rb_init_augmented (struct rbtree *t, rb_update_func *update) {
+	ASSERT (t != NULL);
+
+	t->root = NULL;
+	t->first = NULL;
+	t->update = update;
+}
+
+/* Returns true if N is a red node, false if it is black or null. */
+static inline bool
+is_red (const struct rb_node *n) {
+	return n != NULL && n->red;
+}
+
+/* Makes NEW take the place of OLD as a child of OLD's parent in
+   T.  Does not update NEW's parent pointer. */
+static void
+replace_child (struct rbtree *t, struct rb_node *old, struct rb_node *new) {
+	struct rb_node *parent = old->parent;
+
+	if (parent == NULL)
+		t->root = new;
+	else if (parent->left == old)
+		parent->left = new;
+	else
+		parent->right = new;
+}
+
+/*     X               Y
+      / \             / \
+     a   Y    -->    X   c
+        / \         / \
+       b   c       a   b      */
+static void
+rotate_left (struct rbtree *t, struct rb_node *x) {
+	struct rb_node *y = x->right;
+
+	x->right = y->left;
+	if (y->left != NULL)
+		y->left->parent = x;
+	replace_child (t, x, y);
+	y->parent = x->parent;
+	y->left = x;
+	x->parent = y;
+
+	if (t->update != NULL) {
+		t->update (x);
+		t->update (y);
+	}
+}
+
+/* The mirror image of rotate_left(). */
+static void
+rotate_right (struct rbtree *t, struct rb_node *x) {
+	struct rb_node *y = x->left;
+
+	x->left = y->right;
+	if (y->right != NULL)
+		y->right->parent = x;
+	replace_child (t, x, y);
+	y->parent = x->parent;
+	y->right = x;
+	x->parent = y;
+
+	if (t->update != NULL) {
+		t->update (x);
+		t->update (y);
+	}
+}
+
+/* Inserts N into T at the position given by LESS and auxiliary
+   data AUX, after any nodes that compare equal to N. */
+void
+rb_insert (struct rbtree *t, struct rb_node *n,
+		rb_less_func *less, void *aux) {
+	struct rb_node **link = &t->root;
+	struct rb_node *parent = NULL;
+	bool leftmost = true;
+
+	ASSERT (n != NULL);
+	ASSERT (less != NULL);
+
+	while (*link != NULL) {
+		parent = *link;
+		if (less (n, parent, aux))
+			link = &parent->left;
+		else {
+			link = &parent->right;
+			leftmost = false;
+		}
+	}
+
+	n->parent = parent;
+	n->left = n->right = NULL;
+	n->red = true;
+	*link = n;
+	if (leftmost)
+		t->first = n;
+
+	propagate (t, n);
+	insert_fixup (t, n);
+}
+
+/* Restores the red-black properties after N was inserted red. */
+static void
+insert_fixup (struct rbtree *t, struct rb_node *n) {
+	struct rb_node *p;
+
+	while (is_red (p = n->parent)) {
+		/* P is red, so it is not the root and has a parent. */
+		struct rb_node *g = p->parent;
+
+		if (p == g->left) {
+			struct rb_node *u = g->right;
+
+			if (is_red (u)) {
+				p->red = u->red = false;
+				g->red = true;
+				n = g;
+			} else {
+				if (n == p->right) {
+					rotate_left (t, p);
+					n = p;
+					p = n->parent;
+				}
+				p->red = false;
+				g->red = true;
+				rotate_right (t, g);
+			}
+		} else {
+			struct rb_node *u = g->left;
+
+			if (is_red (u)) {
+				p->red = u->red = false;
+				g->red = true;
+				n = g;
+			} else {
+				if (n == p->left) {
+					rotate_right (t, p);
+					n = p;
+					p = n->parent;
+				}
+				p->red = false;
+				g->red = true;
+				rotate_left (t, g);
+			}
+		}
+	}
+	t->root->red = false;
+}
+
+/* Removes N from T. */
+void
+rb_remove (struct rbtree *t, struct rb_node *n) {
+	struct rb_node *child, *parent;
+	bool removed_red;
+
+	ASSERT (n != NULL);
+
+	if (t->first == n)
+		t->first = rb_next (n);
+
+	if (n->left == NULL || n->right == NULL) {
+		/* N has at most one child, which takes its place. */
+		child = n->left != NULL ? n->left : n->right;
+		parent = n->parent;
+		removed_red = n->red;
+		if (child != NULL)
+			child->parent = parent;
+		replace_child (t, n, child);
+	} else {
+		/* N's successor S, which has no left child, takes N's
+		   place, and S's right child takes S's place. */
+		struct rb_node *s = n->right;
+
+		while (s->left != NULL)
+			s = s->left;
+		child = s->right;
+		removed_red = s->red;
+
+		if (s->parent == n)
+			parent = s;
+		else {
+			parent = s->parent;
+			parent->left = child;
+			if (child != NULL)
+				child->parent = parent;
+			s->right = n->right;
+			s->right->parent = s;
+		}
+		s->left = n->left;
+		s->left->parent = s;
+		replace_child (t, n, s);
+		s->parent = n->parent;
+		s->red = n->red;
+	}
+
+	propagate (t, parent);
+	if (!removed_red)
+		remove_fixup (t, child, parent);
+}
+
+/* Restores the red-black properties after a black node was
+   removed from above X, a child of PARENT (X may be null). */
+static void
+remove_fixup (struct rbtree *t, struct rb_node *x, struct rb_node *parent) {
+	while (x != t->root && !is_red (x)) {
+		if (x == parent->left) {
+			struct rb_node *w = parent->right;
+
+			if (is_red (w)) {
+				w->red = false;
+				parent->red = true;
+				rotate_left (t, parent);
+				w = parent->right;
+			}
+			if (!is_red (w->left) && !is_red (w->right)) {
+				w->red = true;
+				x = parent;
+				parent = x->parent;
+			} else {
+				if (!is_red (w->right)) {
+					w->left->red = false;
+					w->red = true;
+					rotate_right (t, w);
+					w = parent->right;
+				}
+				w->red = parent->red;
+				parent->red = false;
+				w->right->red = false;
+				rotate_left (t, parent);
+				x = t->root;
+			}
+		} else {
+			struct rb_node *w = parent->left;
+
+			if (is_red (w)) {
+				w->red = false;
+				parent->red = true;
+				rotate_right (t, parent);
+				w = parent->left;
+			}
+			if (!is_red (w->left) && !is_red (w->right)) {
+				w->red = true;
+				x = parent;
+				parent = x->parent;
+			} else {
+				if (!is_red (w->left)) {
+					w->right->red = false;
+					w->red = true;
+					rotate_left (t, w);
+					w = parent->left;
+				}
+				w->red = parent->red;
+				parent->red = false;
+				w->left->red = false;
+				rotate_right (t, parent);
+				x = t->root;
+			}
+		}
+	}
+	if (x != NULL)
+		x->red = false;
+}
+
+/* Recomputes the augmented data of N and each of its ancestors
+   in T, from the bottom up. */
+static void
+propagate (struct rbtree *t, struct rb_node *n) {
+	if (t->update == NULL)
+		return;
+	for (; n != NULL; n = n->parent)
+		t->update (n);
+}
+
+/* Returns the first node in T that is not less than KEY according
+   to LESS and auxiliary data AUX, or a null pointer if there is
+   none. */
+struct rb_node *
+rb_lower_bound (struct rbtree *t, const struct rb_node *key,
+		rb_less_func *less, void *aux) {
+	struct rb_node *n = t->root;
+	struct rb_node *bound = NULL;
+
+	while (n != NULL) {
+		if (less (n, key, aux))
+			n = n->right;
+		else {
+			bound = n;
+			n = n->left;
+		}
+	}
+	return bound;
+}
+
+/* Returns the first node in T equal to KEY according to LESS and
+   auxiliary data AUX, or a null pointer if there is none. */
+struct rb_node *
+rb_find (struct rbtree *t, const struct rb_node *key,
+		rb_less_func *less, void *aux) {
+	struct rb_node *n = rb_lower_bound (t, key, less, aux);
+
+	return n != NULL && !less (key, n, aux) ? n : NULL;
+}
+
+/* Returns the first node in T, or a null pointer if T is empty. */
+struct rb_node *
+rb_first (struct rbtree *t) {
+	return t->first;
+}
+
+/* Returns the last node in T, or a null pointer if T is empty. */
+struct rb_node *
+rb_last (struct rbtree *t) {
+	struct rb_node *n = t->root;
+
+	if (n != NULL)
+		while (n->right != NULL)
+			n = n->right;
+	return n;
+}
+
+/* Returns the node after N in its tree, or a null pointer if N is
+   the last node. */
+struct rb_node *
+rb_next (struct rb_node *n) {
+	if (n->right != NULL) {
+		n = n->right;
+		while (n->left != NULL)
+			n = n->left;
+		return n;
+	}
+	while (n->parent != NULL && n == n->parent->right)
+		n = n->parent;
+	return n->parent;
+}
+
+/* Returns the node before N in its tree, or a null pointer if N
+   is the first node. */
+struct rb_node *
+rb_prev (struct rb_node *n) {
+	if (n->left != NULL) {
+		n = n->left;
+		while (n->right != NULL)
+			n = n->right;
+		return n;
+	}
+	while (n->parent != NULL && n == n->parent->left)
+		n = n->parent;
+	return n->parent;
+}
+
+/* Returns true if T is empty, false otherwise. */
+bool
+rb_empty (struct rbtree *t) {
+	return t->root == NULL;
+}
+
+/* Interval tree. */
+
+#define itree_entry(RB_NODE) rb_entry (RB_NODE, struct interval_node, rb)
+
+/* Recomputes the largest `last' in the subtree rooted at N. */
+static void
+itree_update (struct rb_node *n) {
+	struct interval_node *in = itree_entry (n);
+	uint64_t subtree_last = in->last;
+
+	if (n->left != NULL && itree_entry (n->left)->subtree_last > subtree_last)
+		subtree_last = itree_entry (n->left)->subtree_last;
+	if (n->right != NULL && itree_entry (n->right)->subtree_last > subtree_last)
+		subtree_last = itree_entry (n->right)->subtree_last;
+	in->subtree_last = subtree_last;
+}
+
+/* Orders intervals by their first point. */
+static bool
+itree_less (const struct rb_node *a, const struct rb_node *b,
+		void *aux UNUSED) {
+	return itree_entry (a)->start < itree_entry (b)->start;
+}
+
+/* Initializes T as an empty interval tree. */
+void
+itree_init (struct rbtree *t) {
+	rb_init_augmented (t, itree_update);
+}
+
+/* Inserts interval N into interval tree T. */
+void
+itree_insert (struct rbtree *t, struct interval_node *n) {
+	ASSERT (n->start <= n->last);
+
+	n->subtree_last = n->last;
+	rb_insert (t, &n->rb, itree_less, NULL);
+}
+
+/* Removes interval N from interval tree T. */
+void
+itree_remove (struct rbtree *t, struct interval_node *n) {
+	rb_remove (t, &n->rb);
+}
+
+/* Returns the leftmost interval in the subtree rooted at N that
+   overlaps [START, LAST], or a null pointer if there is none.
+   N->subtree_last must be at least START. */
+static struct interval_node *
+itree_subtree_search (struct interval_node *n, uint64_t start, uint64_t last) {
+	for (;;) {
+		/* The leftmost overlap is in the left subtree, if the
+		   left subtree reaches START at all. */
+		if (n->rb.left != NULL) {
+			struct interval_node *left = itree_entry (n->rb.left);
+			if (left->subtree_last >= start) {
+				n = left;
+				continue;
+			}
+		}
+		if (n->start <= last) {
+			if (n->last >= start)
+				return n;
+			if (n->rb.right != NULL) {
+				n = itree_entry (n->rb.right);
+				if (n->subtree_last >= start)
+					continue;
+			}
+		}
+		return NULL;
+	}
+}
+
+/* Returns the first interval in T, in order of first point, that
+   overlaps [START, LAST], or a null pointer if there is none. */
+struct interval_node *
+itree_first (struct rbtree *t, uint64_t start, uint64_t last) {
+	struct interval_node *root;
+
+	if (t->root == NULL)
+		return NULL;
+	root = itree_entry (t->root);
+	if (root->subtree_last < start)
+		return NULL;
+	return itree_subtree_search (root, start, last);
+}
+
+/* Returns the interval after N, in order of first point, that
+   overlaps [START, LAST], or a null pointer if there is none. */
+struct interval_node *
+itree_next (struct interval_node *n, uint64_t start, uint64_t last) {
+	struct rb_node *rb = n->rb.right;
+	struct rb_node *prev;
+
+	for (;;) {
+		/* Everything after N in N's subtree is in its right
+		   subtree. */
+		if (rb != NULL) {
+			struct interval_node *right = itree_entry (rb);
+			if (right->subtree_last >= start)
+				return itree_subtree_search (right, start, last);
+		}
+
+		/* Climb until we come up from a left child: that
+		   ancestor is the next interval. */
+		do {
+			rb = n->rb.parent;
+			if (rb == NULL)
+				return NULL;
+			prev = &n->rb;
+			n = itree_entry (rb);
+			rb = n->rb.right;
+		} while (prev == rb);
+
+		if (last < n->start)
+			return NULL;
+		if (start <= n->last)
+			return n;
+	}
+}
@@ -54,7 +54,7 @@ __attribute__((always_inline)) static __inline int64_t syscall(uint64_t num_, ui
 			((uint64_t)ARG2), 0, 0, 0))
 
 #define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3) ( \
-	syscall(((uint64_t *)NUMBER),                  \
+	syscall(((uint64_t)NUMBER),                    \
 			((uint64_t)ARG0),                      \
 			((uint64_t)ARG1),                      \
 			((uint64_t)ARG2),                      \
@@ -197,3 +197,23 @@ int umount(const char *path)
 {
 	return syscall1(SYS_UMOUNT, path);
 }
+
+int memstat(struct memstat *ms)
+{
+	return syscall1(SYS_MEMSTAT, ms);
+}
+
+int sysring_enter(struct sysring *ring)
+{
+	return syscall1(SYS_SYSRING_ENTER, ring);
+}
+
+pid_t spawn(const char *file, char *const argv[], const int fds[], int fd_cnt)
+{
+	return (pid_t)syscall4(SYS_SPAWN, file, argv, fds, fd_cnt);
+}
+
+int getrusage(int who, struct rusage *usage)
+{
+	return syscall2(SYS_GETRUSAGE, who, usage);
+}
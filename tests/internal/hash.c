@@ -0,0 +1,174 @@
+/* Test program for lib/kernel/hash.c.
+
+   Runs a random mix of insertions, deletions and lookups against
+   both the chained table, which migrates its buckets
+   incrementally, and the open-addressing table, checking every
+   result against a plain array of flags.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <hash.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/test.h"
+
+/* Number of distinct keys. */
+#define KEY_CNT 1024
+
+/* Number of random operations per pass. */
+#define OP_CNT 20000
+
+/* A hash table element. */
+struct value 
+  {
+    struct hash_elem elem;      /* Hash element. */
+    int key;                    /* Key. */
+  };
+
+static struct value values[KEY_CNT];
+static bool present[KEY_CNT];
+static size_t visited;
+
+static uint64_t value_hash (const struct hash_elem *, void *);
+static bool value_less (const struct hash_elem *, const struct hash_elem *,
+                        void *);
+static bool value_equal (const struct hash_elem *, const struct hash_elem *,
+                         void *);
+static void count_value (struct hash_elem *, void *);
+
+/* Applies a random operation on a random key to H or, if H is
+   null, to O.  Returns the change in the number of elements. */
+static int
+random_op (struct hash *h, struct ohash *o) 
+{
+  int key = random_ulong () % KEY_CNT;
+  struct value probe;
+  struct hash_elem *e;
+
+  probe.key = key;
+  switch (random_ulong () % 3) 
+    {
+    case 0:
+      e = h != NULL ? hash_insert (h, &values[key].elem)
+                    : ohash_insert (o, &values[key].elem);
+      ASSERT (e == (present[key] ? &values[key].elem : NULL));
+      if (!present[key])
+        {
+          present[key] = true;
+          return 1;
+        }
+      return 0;
+
+    case 1:
+      e = h != NULL ? hash_delete (h, &probe.elem)
+                    : ohash_delete (o, &probe.elem);
+      ASSERT (e == (present[key] ? &values[key].elem : NULL));
+      if (present[key])
+        {
+          present[key] = false;
+          return -1;
+        }
+      return 0;
+
+    default:
+      e = h != NULL ? hash_find (h, &probe.elem)
+                    : ohash_find (o, &probe.elem);
+      ASSERT (e == (present[key] ? &values[key].elem : NULL));
+      return 0;
+    }
+}
+
+/* Test the chained and open-addressing hash tables. */
+void
+test (void) 
+{
+  int pass;
+
+  for (pass = 0; pass < KEY_CNT; pass++)
+    values[pass].key = pass;
+
+  printf ("testing hash:");
+  for (pass = 0; pass < 2; pass++) 
+    {
+      struct hash h;
+      struct ohash o;
+      size_t size = 0;
+      int i;
+
+      memset (present, 0, sizeof present);
+      if (pass == 0)
+        ASSERT (hash_init (&h, value_hash, value_less, NULL));
+      else
+        ASSERT (ohash_init (&o, value_hash, value_equal, NULL));
+
+      for (i = 0; i < OP_CNT; i++) 
+        {
+          size += random_op (pass == 0 ? &h : NULL, &o);
+
+          /* Every element must be visited exactly once, including
+             while buckets are being migrated. */
+          if (i % 1000 == 0) 
+            {
+              visited = 0;
+              if (pass == 0)
+                hash_apply (&h, count_value);
+              else
+                ohash_apply (&o, count_value);
+              ASSERT (visited == size);
+              ASSERT ((pass == 0 ? hash_size (&h) : ohash_size (&o)) == size);
+            }
+        }
+
+      if (pass == 0)
+        hash_destroy (&h, NULL);
+      else
+        ohash_destroy (&o, NULL);
+      printf (".");
+    }
+  printf (" done\n");
+  printf ("hash: PASS\n");
+}
+
+/* Returns a hash of the key of value E. */
+static uint64_t
+value_hash (const struct hash_elem *e, void *aux UNUSED) 
+{
+  return hash_int (hash_entry (e, struct value, elem)->key);
+}
+
+/* Returns true if value A is less than value B, false
+   otherwise. */
+static bool
+value_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED) 
+{
+  const struct value *a = hash_entry (a_, struct value, elem);
+  const struct value *b = hash_entry (b_, struct value, elem);
+  
+  return a->key < b->key;
+}
+
+/* Returns true if value A is equal to value B, false
+   otherwise. */
+static bool
+value_equal (const struct hash_elem *a_, const struct hash_elem *b_,
+             void *aux UNUSED) 
+{
+  const struct value *a = hash_entry (a_, struct value, elem);
+  const struct value *b = hash_entry (b_, struct value, elem);
+  
+  return a->key == b->key;
+}
+
+/* Counts a visited value. */
+static void
+count_value (struct hash_elem *e, void *aux UNUSED) 
+{
+  ASSERT (present[hash_entry (e, struct value, elem)->key]);
+  visited++;
+}
@@ -0,0 +1,82 @@
+/* Test program for lib/kernel/lz.c.
+
+   Attempts to test the compressor on inputs of various
+   compressibility, checking that every block decompresses to its
+   input and that overflowing the output buffer is detected.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <lz.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/test.h"
+
+/* Size of the blocks we compress. */
+#define BLOCK_SIZE 4096
+
+/* Number of kinds of input, see fill(). */
+#define KIND_CNT 5
+
+static void fill (unsigned char[], int kind);
+
+/* Test compression and decompression. */
+void
+test (void) 
+{
+  static unsigned char in[BLOCK_SIZE], out[BLOCK_SIZE * 2], back[BLOCK_SIZE];
+  static unsigned char work[LZ_WORK_SIZE];
+  int repeat;
+
+  printf ("testing lz:");
+  for (repeat = 0; repeat < 100; repeat++) 
+    {
+      int kind;
+
+      for (kind = 0; kind < KIND_CNT; kind++) 
+        {
+          size_t size;
+
+          fill (in, kind);
+          size = lz_compress (in, BLOCK_SIZE, out, sizeof out, work);
+          ASSERT (size > 0);
+          ASSERT (lz_decompress (out, size, back, BLOCK_SIZE) == BLOCK_SIZE);
+          ASSERT (!memcmp (in, back, BLOCK_SIZE));
+          ASSERT (lz_compress (in, BLOCK_SIZE, out, size - 1, work) == 0);
+        }
+      printf (".");
+    }
+  printf (" done\n");
+}
+
+/* Fills BUF with data of the given KIND, from incompressible to
+   a single repeated byte. */
+static void
+fill (unsigned char buf[], int kind) 
+{
+  size_t i;
+
+  for (i = 0; i < BLOCK_SIZE; i++)
+    switch (kind) 
+      {
+      case 0:
+        buf[i] = random_ulong ();
+        break;
+      case 1:
+        buf[i] = random_ulong () % 3;
+        break;
+      case 2:
+        buf[i] = random_ulong () % 16 == 0 ? random_ulong () : 0;
+        break;
+      case 3:
+        buf[i] = "hello, world "[i % 13];
+        break;
+      default:
+        buf[i] = 0;
+        break;
+      }
+}
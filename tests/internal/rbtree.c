@@ -0,0 +1,166 @@
+/* Test program for lib/kernel/rbtree.c.
+
+   Inserts and removes random intervals, checking after each
+   batch that the tree is ordered and balanced, that every
+   subtree's largest endpoint is correct, and that interval
+   queries find exactly the overlapping intervals.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <rbtree.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Number of intervals. */
+#define INTERVAL_CNT 512
+
+/* Intervals start in [0, SPAN) and are shorter than MAX_LEN. */
+#define SPAN 10000
+#define MAX_LEN 300
+
+static struct interval_node intervals[INTERVAL_CNT];
+static bool present[INTERVAL_CNT];
+
+static int verify_subtree (struct rb_node *);
+static void verify_tree (struct rbtree *, size_t size);
+static void verify_query (struct rbtree *, uint64_t start, uint64_t last);
+
+/* Test the red-black and interval trees. */
+void
+test (void) 
+{
+  struct rbtree tree;
+  size_t size = 0;
+  int repeat;
+
+  printf ("testing rbtree:");
+  itree_init (&tree);
+  for (repeat = 0; repeat < 100; repeat++) 
+    {
+      int i;
+
+      for (i = 0; i < INTERVAL_CNT; i++) 
+        {
+          int idx = random_ulong () % INTERVAL_CNT;
+          struct interval_node *n = &intervals[idx];
+
+          if (present[idx]) 
+            {
+              itree_remove (&tree, n);
+              size--;
+            }
+          else 
+            {
+              n->start = random_ulong () % SPAN;
+              n->last = n->start + random_ulong () % MAX_LEN;
+              itree_insert (&tree, n);
+              size++;
+            }
+          present[idx] = !present[idx];
+        }
+
+      verify_tree (&tree, size);
+      for (i = 0; i < 10; i++) 
+        {
+          uint64_t start = random_ulong () % SPAN;
+          verify_query (&tree, start, start + random_ulong () % (MAX_LEN * 4));
+        }
+      printf (".");
+    }
+  printf (" done\n");
+  printf ("rbtree: PASS\n");
+}
+
+/* Verifies the red-black properties and the augmented data of
+   the subtree rooted at N, and returns its black height. */
+static int
+verify_subtree (struct rb_node *n) 
+{
+  struct interval_node *in;
+  uint64_t subtree_last;
+  int left_height;
+
+  if (n == NULL)
+    return 1;
+
+  in = rb_entry (n, struct interval_node, rb);
+  subtree_last = in->last;
+  if (n->left != NULL) 
+    {
+      struct interval_node *left = rb_entry (n->left, struct interval_node, rb);
+      ASSERT (n->left->parent == n);
+      ASSERT (!n->red || !n->left->red);
+      ASSERT (left->start <= in->start);
+      if (left->subtree_last > subtree_last)
+        subtree_last = left->subtree_last;
+    }
+  if (n->right != NULL) 
+    {
+      struct interval_node *right = rb_entry (n->right, struct interval_node, rb);
+      ASSERT (n->right->parent == n);
+      ASSERT (!n->red || !n->right->red);
+      ASSERT (right->start >= in->start);
+      if (right->subtree_last > subtree_last)
+        subtree_last = right->subtree_last;
+    }
+  ASSERT (in->subtree_last == subtree_last);
+
+  left_height = verify_subtree (n->left);
+  ASSERT (left_height == verify_subtree (n->right));
+  return left_height + !n->red;
+}
+
+/* Verifies that TREE is a valid interval tree holding SIZE
+   intervals in order. */
+static void
+verify_tree (struct rbtree *tree, size_t size) 
+{
+  struct rb_node *n;
+  uint64_t prev = 0;
+  size_t cnt = 0;
+
+  ASSERT (tree->root == NULL || !tree->root->red);
+  verify_subtree (tree->root);
+
+  for (n = rb_first (tree); n != NULL; n = rb_next (n)) 
+    {
+      struct interval_node *in = rb_entry (n, struct interval_node, rb);
+      ASSERT (in->start >= prev);
+      prev = in->start;
+      cnt++;
+    }
+  ASSERT (cnt == size);
+  ASSERT (rb_empty (tree) == (size == 0));
+
+  for (cnt = 0, n = rb_last (tree); n != NULL; n = rb_prev (n))
+    cnt++;
+  ASSERT (cnt == size);
+}
+
+/* Verifies that iterating over the intervals in TREE that
+   overlap [START, LAST] finds each overlapping interval, and only
+   those. */
+static void
+verify_query (struct rbtree *tree, uint64_t start, uint64_t last) 
+{
+  struct interval_node *n;
+  size_t expected = 0, found = 0;
+  int i;
+
+  for (i = 0; i < INTERVAL_CNT; i++)
+    if (present[i] && intervals[i].start <= last && intervals[i].last >= start)
+      expected++;
+
+  for (n = itree_first (tree, start, last); n != NULL;
+       n = itree_next (n, start, last)) 
+    {
+      ASSERT (n->start <= last && n->last >= start);
+      found++;
+    }
+  ASSERT (found == expected);
+}
@@ -0,0 +1,95 @@
+/* Measures the cost of malloc()/free() and of
+   palloc_get_page()/palloc_free_page(), both one at a time, which
+   stays inside the per-CPU magazines, and in bursts large enough
+   to make them refill from and drain to the shared pools.  Prints
+   the average cost of an allocate/free pair in CPU cycles, as
+   read from the time-stamp counter.
+
+   This is a benchmark: it passes as long as every allocation
+   succeeds, whatever the numbers turn out to be. */
+
+#include <stdio.h>
+#include "intrinsic.h"
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+
+/* Number of allocate/free pairs per measurement. */
+#define OPS 65536
+
+/* Number of objects allocated before any is freed in a burst.
+   Must divide OPS. */
+#define BURST 64
+
+static void *objs[BURST];
+
+static void report (const char *what, uint64_t start);
+static void *do_malloc (void);
+static void *do_palloc (void);
+
+static void
+bench_single (const char *what, void *(*alloc) (void), void (*release) (void *))
+{
+  uint64_t start = rdtsc ();
+  int i;
+
+  for (i = 0; i < OPS; i++)
+    {
+      void *p = alloc ();
+      if (p == NULL)
+        fail ("%s: allocation %d failed", what, i);
+      release (p);
+    }
+  report (what, start);
+}
+
+static void
+bench_burst (const char *what, void *(*alloc) (void), void (*release) (void *))
+{
+  uint64_t start = rdtsc ();
+  int i, j;
+
+  for (i = 0; i < OPS / BURST; i++)
+    {
+      for (j = 0; j < BURST; j++)
+        if ((objs[j] = alloc ()) == NULL)
+          fail ("%s: allocation %d failed", what, i * BURST + j);
+      for (j = 0; j < BURST; j++)
+        release (objs[j]);
+    }
+  report (what, start);
+}
+
+void
+test_alloc_bench (void) 
+{
+  bench_single ("malloc(64)/free", do_malloc, free);
+  bench_burst ("malloc(64)/free burst", do_malloc, free);
+  bench_single ("palloc_get_page/palloc_free_page", do_palloc,
+                palloc_free_page);
+  bench_burst ("palloc_get_page/palloc_free_page burst", do_palloc,
+               palloc_free_page);
+  pass ();
+}
+
+/* Prints the average cost of an operation of the benchmark WHAT,
+   which began when the time-stamp counter read START. */
+static void
+report (const char *what, uint64_t start)
+{
+  uint64_t cycles = rdtsc () - start;
+
+  msg ("%s: %llu cycles/op", what, (unsigned long long) (cycles / OPS));
+}
+
+static void *
+do_malloc (void)
+{
+  return malloc (64);
+}
+
+static void *
+do_palloc (void)
+{
+  return palloc_get_page (0);
+}
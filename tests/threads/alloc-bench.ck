@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my (@expected) = ("malloc(64)/free",
+		  "malloc(64)/free burst",
+		  "palloc_get_page/palloc_free_page",
+		  "palloc_get_page/palloc_free_page burst");
+for my $what (@expected) {
+    fail "missing timing for $what\n"
+      if !grep (/^\(alloc-bench\) \Q$what\E: \d+ cycles\/op$/, @output);
+}
+fail "missing PASS\n" if !grep (/^\(alloc-bench\) PASS$/, @output);
+pass;
@@ -0,0 +1,117 @@
+/* Measures how fast threads can be created and joined, one at a
+   time, so that each new thread can reuse the page of the one
+   before it, and in bursts that outgrow the pool of recycled
+   thread pages.  Also measures pml4_create()/pml4_destroy(),
+   which process creation adds on top.  Prints the average cost
+   in CPU cycles per operation, as read from the time-stamp
+   counter.
+
+   This is a benchmark: it passes as long as every thread runs
+   and every allocation succeeds, whatever the numbers turn out
+   to be. */
+
+#include <stdio.h>
+#include "intrinsic.h"
+#include "tests/threads/tests.h"
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Number of threads or page tables per measurement. */
+#define OPS 1024
+
+/* Number of threads started before any is joined in a burst.
+   Must divide OPS. */
+#define BURST 32
+
+static void report (const char *what, uint64_t start);
+static void spawn (const char *what, struct semaphore *done);
+static void child (void *done_);
+
+static void
+bench_spawn_join (void)
+{
+  struct semaphore done;
+  uint64_t start = rdtsc ();
+  int i;
+
+  sema_init (&done, 0);
+  for (i = 0; i < OPS; i++)
+    {
+      spawn ("spawn/join", &done);
+      sema_down (&done);
+    }
+  report ("spawn/join", start);
+}
+
+static void
+bench_spawn_join_burst (void)
+{
+  struct semaphore done;
+  uint64_t start = rdtsc ();
+  int i, j;
+
+  sema_init (&done, 0);
+  for (i = 0; i < OPS / BURST; i++)
+    {
+      for (j = 0; j < BURST; j++)
+        spawn ("spawn/join burst", &done);
+      for (j = 0; j < BURST; j++)
+        sema_down (&done);
+    }
+  report ("spawn/join burst", start);
+}
+
+static void
+bench_pml4 (void)
+{
+  uint64_t start = rdtsc ();
+  int i;
+
+  for (i = 0; i < OPS; i++)
+    {
+      uint64_t *pml4 = pml4_create ();
+      if (pml4 == NULL)
+        fail ("pml4_create/pml4_destroy: allocation %d failed", i);
+      pml4_destroy (pml4);
+    }
+  report ("pml4_create/pml4_destroy", start);
+}
+
+void
+test_spawn_bench (void) 
+{
+  /* The children must not preempt us before we block. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  bench_spawn_join ();
+  bench_spawn_join_burst ();
+  bench_pml4 ();
+  pass ();
+}
+
+/* Prints the average cost of an operation of the benchmark WHAT,
+   which began when the time-stamp counter read START. */
+static void
+report (const char *what, uint64_t start)
+{
+  uint64_t cycles = rdtsc () - start;
+
+  msg ("%s: %llu cycles/op", what, (unsigned long long) (cycles / OPS));
+}
+
+/* Starts a thread that ups DONE and exits. */
+static void
+spawn (const char *what, struct semaphore *done)
+{
+  if (thread_create ("child", PRI_DEFAULT, child, done) == TID_ERROR)
+    fail ("%s: thread_create failed", what);
+}
+
+static void
+child (void *done_) 
+{
+  struct semaphore *done = done_;
+
+  sema_up (done);
+}
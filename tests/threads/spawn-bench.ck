@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my (@expected) = ("spawn/join",
+		  "spawn/join burst",
+		  "pml4_create/pml4_destroy");
+for my $what (@expected) {
+    fail "missing timing for $what\n"
+      if !grep (/^\(spawn-bench\) \Q$what\E: \d+ cycles\/op$/, @output);
+}
+fail "missing PASS\n" if !grep (/^\(spawn-bench\) PASS$/, @output);
+pass;
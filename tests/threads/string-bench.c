@@ -0,0 +1,186 @@
+/* Compares the throughput of memcpy(), memmove(), memset(),
+   memcmp() and strlen() with that of the byte-at-a-time loops they
+   replaced, on page-sized buffers, and prints both in bytes per
+   CPU cycle as read from the time-stamp counter.  Also checks that
+   both give the same results.
+
+   This is a benchmark: it passes as long as the results agree,
+   whatever the numbers turn out to be. */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "intrinsic.h"
+#include "tests/threads/tests.h"
+#include "threads/vaddr.h"
+
+/* Number of calls per measurement. */
+#define ITERS 256
+
+static uint8_t src[PGSIZE], dst[PGSIZE], ref[PGSIZE];
+
+/* The byte loops, as lib/string.c used to have them. */
+
+static void *
+byte_memcpy (void *dst_, const void *src_, size_t size)
+{
+  unsigned char *dst = dst_;
+  const unsigned char *src = src_;
+
+  while (size-- > 0)
+    *dst++ = *src++;
+  return dst_;
+}
+
+static void *
+byte_memmove (void *dst_, const void *src_, size_t size)
+{
+  unsigned char *dst = dst_;
+  const unsigned char *src = src_;
+
+  if (dst < src)
+    while (size-- > 0)
+      *dst++ = *src++;
+  else
+    {
+      dst += size;
+      src += size;
+      while (size-- > 0)
+        *--dst = *--src;
+    }
+  return dst_;
+}
+
+static void *
+byte_memset (void *dst_, int value, size_t size)
+{
+  unsigned char *dst = dst_;
+
+  while (size-- > 0)
+    *dst++ = value;
+  return dst_;
+}
+
+static int
+byte_memcmp (const void *a_, const void *b_, size_t size)
+{
+  const unsigned char *a = a_;
+  const unsigned char *b = b_;
+
+  for (; size-- > 0; a++, b++)
+    if (*a != *b)
+      return *a > *b ? +1 : -1;
+  return 0;
+}
+
+static size_t
+byte_strlen (const char *string)
+{
+  const char *p;
+
+  for (p = string; *p != '\0'; p++)
+    continue;
+  return p - string;
+}
+
+/* One operation on the buffers, byte loop or not. */
+typedef void bench_func (bool bytewise);
+
+static void
+do_memcpy (bool bytewise)
+{
+  (bytewise ? byte_memcpy : memcpy) (dst, src, PGSIZE);
+}
+
+static void
+do_memmove (bool bytewise)
+{
+  (bytewise ? byte_memmove : memmove) (dst + 1, dst, PGSIZE - 1);
+}
+
+static void
+do_memset (bool bytewise)
+{
+  (bytewise ? byte_memset : memset) (dst, 0x5a, PGSIZE);
+}
+
+static void
+do_memcmp (bool bytewise)
+{
+  if ((bytewise ? byte_memcmp : memcmp) (src, ref, PGSIZE) != 0)
+    fail ("memcmp found equal buffers different");
+}
+
+static void
+do_strlen (bool bytewise)
+{
+  if ((bytewise ? byte_strlen : strlen) ((const char *) src) != PGSIZE - 1)
+    fail ("strlen returned the wrong length");
+}
+
+/* Returns hundredths of a byte per cycle for ITERS calls of F. */
+static unsigned
+measure (bench_func *f, bool bytewise)
+{
+  uint64_t start, cycles;
+  int i;
+
+  start = rdtsc ();
+  for (i = 0; i < ITERS; i++)
+    f (bytewise);
+  cycles = rdtsc () - start;
+  return (uint64_t) ITERS * PGSIZE * 100 / (cycles > 0 ? cycles : 1);
+}
+
+static void
+bench (const char *name, bench_func *f)
+{
+  unsigned before = measure (f, true);
+  unsigned after = measure (f, false);
+
+  msg ("%s: %u.%02u -> %u.%02u bytes/cycle", name,
+       before / 100, before % 100, after / 100, after % 100);
+}
+
+void
+test_string_bench (void) 
+{
+  size_t i;
+
+  /* A string of PGSIZE - 1 nonzero bytes. */
+  for (i = 0; i < PGSIZE; i++)
+    src[i] = i % 251 + 1;
+  src[PGSIZE - 1] = '\0';
+  memcpy (ref, src, PGSIZE);
+
+  /* Odd sizes and offsets, checked against the byte loops. */
+  for (i = 0; i < 64; i++)
+    {
+      byte_memset (dst, 0, PGSIZE);
+      byte_memset (ref, 0, PGSIZE);
+      memcpy (dst + i, src + 3, 1000 + i);
+      byte_memcpy (ref + i, src + 3, 1000 + i);
+      memmove (dst + 2 * i, dst + i, 1000 + i);
+      byte_memmove (ref + 2 * i, ref + i, 1000 + i);
+      memmove (dst + i, dst + 2 * i, 1000 + i);
+      byte_memmove (ref + i, ref + 2 * i, 1000 + i);
+      memset (dst + 2000 + i, i, 500 + i);
+      byte_memset (ref + 2000 + i, i, 500 + i);
+      if (byte_memcmp (dst, ref, PGSIZE) != 0)
+        fail ("copy or fill differs from byte loop at size %zu", i);
+      ref[1500 - i] ^= 1;
+      if (memcmp (dst, ref, PGSIZE) != byte_memcmp (dst, ref, PGSIZE))
+        fail ("memcmp differs from byte loop at size %zu", i);
+      if (strlen ((const char *) src + i) != byte_strlen ((const char *) src + i))
+        fail ("strlen differs from byte loop at offset %zu", i);
+    }
+  memcpy (ref, src, PGSIZE);
+
+  bench ("memcpy", do_memcpy);
+  bench ("memmove", do_memmove);
+  bench ("memset", do_memset);
+  bench ("memcmp", do_memcmp);
+  bench ("strlen", do_strlen);
+  pass ();
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+for my $what ("memcpy", "memmove", "memset", "memcmp", "strlen") {
+    fail "missing timing for $what\n"
+      if !grep (/^\(string-bench\) $what: \d+\.\d\d -> \d+\.\d\d bytes\/cycle$/,
+		@output);
+}
+fail "missing PASS\n" if !grep (/^\(string-bench\) PASS$/, @output);
+pass;
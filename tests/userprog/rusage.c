@@ -0,0 +1,54 @@
+/* Checks that getrusage charges user time to the running process,
+   and that a child's usage is added to its parent's on wait. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Spins in user mode until the process has been charged at least
+   TICKS timer ticks of user time. */
+static void
+spin_until_user_ticks (uint64_t ticks)
+{
+  struct rusage ru;
+
+  do
+    {
+      volatile int i;
+      for (i = 0; i < 100000; i++)
+        continue;
+      getrusage (RUSAGE_SELF, &ru);
+    }
+  while (ru.user_ticks < ticks);
+}
+
+void
+test_main (void)
+{
+  struct rusage self, children;
+  int pid, status;
+
+  CHECK (getrusage (RUSAGE_SELF, &self) == 0, "getrusage (RUSAGE_SELF)");
+  CHECK (getrusage (RUSAGE_CHILDREN, &children) == 0,
+         "getrusage (RUSAGE_CHILDREN)");
+  CHECK (children.user_ticks == 0, "no child usage before wait");
+
+  msg ("spin until user time is charged");
+  spin_until_user_ticks (1);
+
+  pid = fork ("child");
+  if (pid == 0)
+    {
+      spin_until_user_ticks (2);
+      exit (0);
+    }
+  status = wait (pid);
+  CHECK (pid > 0 && status == 0, "fork and wait for child");
+
+  CHECK (getrusage (RUSAGE_CHILDREN, &children) == 0,
+         "getrusage (RUSAGE_CHILDREN)");
+  CHECK (children.user_ticks >= 2, "child's user time added on wait");
+  CHECK (getrusage (RUSAGE_SELF, &self) == 0, "getrusage (RUSAGE_SELF)");
+  CHECK (self.context_switches > 0, "waiting counted a context switch");
+  CHECK (getrusage (7, &self) == -1, "getrusage (7) fails");
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(rusage) begin
+(rusage) getrusage (RUSAGE_SELF)
+(rusage) getrusage (RUSAGE_CHILDREN)
+(rusage) no child usage before wait
+(rusage) spin until user time is charged
+(rusage) fork and wait for child
+(rusage) getrusage (RUSAGE_CHILDREN)
+(rusage) child's user time added on wait
+(rusage) getrusage (RUSAGE_SELF)
+(rusage) waiting counted a context switch
+(rusage) getrusage (7) fails
+(rusage) end
+EOF
+pass;
@@ -0,0 +1,22 @@
+/* Starts a child with spawn(), passing it arguments directly
+   rather than through a command line, and waits for it.  Also
+   checks that spawning a missing program fails. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char *argv[] = {"child-args", "child arg", NULL};
+  pid_t pid;
+  int status;
+
+  /* Nothing is printed until the child is done. */
+  pid = spawn ("child-args", argv, NULL, 0);
+  status = pid > 0 ? wait (pid) : -1;
+  CHECK (status == 0, "spawn and wait for \"child-args\"");
+  CHECK (spawn ("no-such-file", NULL, NULL, 0) == PID_ERROR,
+         "spawn \"no-such-file\"");
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(spawn-args) begin
+(args) begin
+(args) argc = 2
+(args) argv[0] = 'child-args'
+(args) argv[1] = 'child arg'
+(args) argv[2] = null
+(args) end
+child-args: exit(0)
+(spawn-args) spawn and wait for "child-args"
+(spawn-args) spawn "no-such-file"
+load: no-such-file: open failed
+no-such-file: exit(-1)
+(spawn-args) end
+spawn-args: exit(0)
+EOF
+pass;
@@ -0,0 +1,49 @@
+/* Starts a child with spawn(), giving it one of our open files
+   as its fd 3 and leaving its fd 2 closed.  The child reads the
+   rest of the file through fd 3, starting where we left off,
+   while our own position is not affected. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/boundary.h"
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char *argv[] = {"child-read", "3", NULL};
+  int fds[4];
+  pid_t pid;
+  int handle;
+  int byte_cnt;
+  char *buffer;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  buffer = get_boundary_area () - sizeof sample / 2;
+  CHECK ((byte_cnt = read (handle, buffer, 20)) == 20,
+         "read \"sample.txt\" first 20 bytes");
+
+  fds[0] = 0;
+  fds[1] = 1;
+  fds[2] = -1;
+  fds[3] = handle;
+  pid = spawn ("child-read", argv, fds, 4);
+  if (pid == PID_ERROR)
+    fail ("spawn(\"child-read\") failed");
+  wait (pid);
+
+  byte_cnt = read (handle, buffer + 20, sizeof sample - 21);
+  if (byte_cnt != sizeof sample - 21)
+    fail ("read() returned %d instead of %zu", byte_cnt, sizeof sample - 21);
+  else if (strcmp (sample, buffer)) {
+      msg ("expected text:\n%s", sample);
+      msg ("text actually read:\n%s", buffer);
+      fail ("expected text differs from actual");
+  } else {
+    msg ("Parent success");
+  }
+
+  close (handle);
+}
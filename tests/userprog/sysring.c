@@ -0,0 +1,79 @@
+/* Queues writes, a seek, a read and a close in a system call
+   ring, runs them with a single sysring_enter(), and checks the
+   completions.  System calls that cannot be batched complete
+   with -1. */
+
+#include <string.h>
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHUNK 16
+#define CHUNK_CNT 8
+
+static struct sysring ring;
+static char wbuf[CHUNK * CHUNK_CNT];
+static char rbuf[CHUNK * CHUNK_CNT];
+
+static void
+submit (uint32_t nr, uint64_t a0, uint64_t a1, uint64_t a2,
+        uint64_t user_data)
+{
+  struct sysring_sqe *sqe = &ring.sq[ring.sq_tail % SYSRING_SIZE];
+
+  sqe->nr = nr;
+  sqe->args[0] = a0;
+  sqe->args[1] = a1;
+  sqe->args[2] = a2;
+  sqe->user_data = user_data;
+  ring.sq_tail++;
+}
+
+static int64_t
+complete (uint64_t user_data)
+{
+  struct sysring_cqe *cqe;
+
+  if (ring.cq_head == ring.cq_tail)
+    fail ("completion queue is empty");
+  cqe = &ring.cq[ring.cq_head++ % SYSRING_SIZE];
+  if (cqe->user_data != user_data)
+    fail ("completion %llu out of order, expected %llu",
+          cqe->user_data, user_data);
+  return cqe->res;
+}
+
+void
+test_main (void)
+{
+  int handle, i;
+
+  for (i = 0; i < (int) sizeof wbuf; i++)
+    wbuf[i] = 'a' + i % 26;
+
+  CHECK (create ("ring.txt", 0), "create \"ring.txt\"");
+  CHECK ((handle = open ("ring.txt")) > 1, "open \"ring.txt\"");
+
+  for (i = 0; i < CHUNK_CNT; i++)
+    submit (SYS_WRITE, handle, (uint64_t) (wbuf + i * CHUNK), CHUNK, i);
+  submit (SYS_SEEK, handle, 0, 0, CHUNK_CNT);
+  submit (SYS_READ, handle, (uint64_t) rbuf, sizeof rbuf, CHUNK_CNT + 1);
+  submit (SYS_TELL, handle, 0, 0, CHUNK_CNT + 2);
+  submit (SYS_EXEC, (uint64_t) "child-simple", 0, 0, CHUNK_CNT + 3);
+  submit (SYS_CLOSE, handle, 0, 0, CHUNK_CNT + 4);
+  CHECK (sysring_enter (&ring) == CHUNK_CNT + 5, "sysring_enter");
+  CHECK (ring.sq_head == ring.sq_tail, "submission queue drained");
+
+  for (i = 0; i < CHUNK_CNT; i++)
+    if (complete (i) != CHUNK)
+      fail ("write %d did not write %d bytes", i, CHUNK);
+  complete (CHUNK_CNT);
+  CHECK (complete (CHUNK_CNT + 1) == (int64_t) sizeof rbuf, "read");
+  CHECK (complete (CHUNK_CNT + 2) == (int64_t) sizeof rbuf, "tell");
+  CHECK (complete (CHUNK_CNT + 3) == -1, "exec is refused");
+  complete (CHUNK_CNT + 4);
+  CHECK (memcmp (wbuf, rbuf, sizeof rbuf) == 0, "read back what was written");
+
+  CHECK (filesize (handle) == -1, "file was closed");
+}
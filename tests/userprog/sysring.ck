@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sysring) begin
+(sysring) create "ring.txt"
+(sysring) open "ring.txt"
+(sysring) sysring_enter
+(sysring) submission queue drained
+(sysring) read
+(sysring) tell
+(sysring) exec is refused
+(sysring) read back what was written
+(sysring) file was closed
+(sysring) end
+sysring: exit(0)
+EOF
+pass;
@@ -0,0 +1,30 @@
+/* Checks that with fault-around turned off by -fa=0, each page of
+   the data segment is mapped by a fault of its own. */
+
+#include <syscall.h>
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_COUNT 32
+
+static uint8_t buf[PAGE_COUNT * PAGE_SIZE]
+  __attribute__ ((aligned (PAGE_SIZE)));
+
+void
+test_main (void)
+{
+  struct rusage before, after;
+  size_t i;
+
+  CHECK (getrusage (RUSAGE_SELF, &before) == 0, "getrusage");
+  for (i = 0; i < PAGE_COUNT; i++)
+    {
+      volatile uint8_t *p = buf + i * PAGE_SIZE;
+      (void) *p;
+    }
+  CHECK (getrusage (RUSAGE_SELF, &after) == 0, "getrusage");
+  CHECK (after.page_faults - before.page_faults >= PAGE_COUNT,
+         "each page took its own fault");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fault-around-off) begin
+(fault-around-off) getrusage
+(fault-around-off) getrusage
+(fault-around-off) each page took its own fault
+(fault-around-off) end
+EOF
+pass;
@@ -0,0 +1,81 @@
+/* Checks that a fault in the data segment maps neighbouring pages,
+   more of them while they are used and fewer while they are not,
+   and that the pages of one segment are never mapped by a fault in
+   another.
+
+   ARENA is the only uninitialized object of this file, which is
+   linked first, so it starts the data segment, and the text segment
+   ends on the page just below it. */
+
+#include <syscall.h>
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+
+/* Pages at the start of ARENA, next to the text segment. */
+#define EDGE_PAGES 16
+
+/* Pages touched with a stride of STRIDE pages. */
+#define SPARSE_TOUCHES 16
+#define STRIDE 16
+
+/* Pages touched in order. */
+#define SEQ_PAGES 128
+
+static uint8_t arena[(EDGE_PAGES + SPARSE_TOUCHES * STRIDE + SEQ_PAGES)
+                     * PAGE_SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+
+/* Returns the number of page faults taken so far. */
+static uint64_t
+faults (void)
+{
+  struct rusage ru;
+
+  getrusage (RUSAGE_SELF, &ru);
+  return ru.page_faults;
+}
+
+/* Returns the resident set size, in pages. */
+static size_t
+rss (void)
+{
+  struct memstat ms;
+
+  memstat (&ms);
+  return ms.rss / PAGE_SIZE;
+}
+
+/* Reads a byte of page PAGE of ARENA. */
+static void
+touch (size_t page)
+{
+  volatile uint8_t *p = arena + page * PAGE_SIZE;
+
+  (void) *p;
+}
+
+void
+test_main (void)
+{
+  uint64_t start_faults;
+  size_t start_rss, i;
+
+  start_faults = faults ();
+  touch (0);
+  CHECK (faults () > start_faults,
+         "first data page was not mapped by text faults");
+
+  start_rss = rss ();
+  for (i = 0; i < SPARSE_TOUCHES; i++)
+    touch (EDGE_PAGES + i * STRIDE);
+  CHECK (rss () - start_rss < SPARSE_TOUCHES * 4,
+         "strided access maps fewer than 4 pages per touch");
+
+  start_faults = faults ();
+  for (i = 0; i < SEQ_PAGES; i++)
+    touch (EDGE_PAGES + SPARSE_TOUCHES * STRIDE + i);
+  CHECK (faults () - start_faults < SEQ_PAGES / 4,
+         "sequential access takes fewer than 1 fault per 4 pages");
+}
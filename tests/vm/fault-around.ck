@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fault-around) begin
+(fault-around) first data page was not mapped by text faults
+(fault-around) strided access maps fewer than 4 pages per touch
+(fault-around) sequential access takes fewer than 1 fault per 4 pages
+(fault-around) end
+EOF
+pass;
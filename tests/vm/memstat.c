@@ -0,0 +1,40 @@
+/* Checks that memstat reports resident memory, and that touching
+   pages of an anonymous buffer grows the resident set.
+
+   A fault also maps up to 64 (the largest -fa) neighbouring pages of
+   its region, so the pages touched sit in the middle of BUF, that
+   many pages away from any data the test wrote before measuring. */
+
+#include <syscall.h>
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define CHUNK_PAGE_COUNT 16
+#define GUARD_PAGE_COUNT 64
+
+static char buf[(GUARD_PAGE_COUNT + CHUNK_PAGE_COUNT + GUARD_PAGE_COUNT)
+                * PAGE_SIZE];
+
+void
+test_main (void)
+{
+	struct memstat before, after;
+	char *chunk;
+	size_t i;
+
+	CHECK (memstat (&before) == 0, "memstat");
+	CHECK (before.rss > 0, "resident set is not empty");
+	CHECK (before.pss <= before.rss, "pss does not exceed rss");
+
+	msg ("touch pages");
+	chunk = buf + GUARD_PAGE_COUNT * PAGE_SIZE;
+	for (i = 0; i < CHUNK_PAGE_COUNT; i++)
+		chunk[i * PAGE_SIZE] = i;
+
+	CHECK (memstat (&after) == 0, "memstat");
+	CHECK (after.rss >= before.rss + CHUNK_PAGE_COUNT * PAGE_SIZE,
+			"resident set grew by the touched pages");
+	CHECK (after.pss <= after.rss, "pss does not exceed rss");
+}
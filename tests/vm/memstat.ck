@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(memstat) begin
+(memstat) memstat
+(memstat) resident set is not empty
+(memstat) pss does not exceed rss
+(memstat) touch pages
+(memstat) memstat
+(memstat) resident set grew by the touched pages
+(memstat) pss does not exceed rss
+(memstat) end
+EOF
+pass;
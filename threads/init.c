@@ -20,8 +20,12 @@
 #include "threads/malloc.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
+#include "threads/prof.h"
 #include "threads/pte.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -32,6 +36,7 @@
 #include "tests/threads/tests.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/zswap.h"
 #endif
 #ifdef FILESYS
 #include "devices/disk.h"
@@ -86,6 +91,8 @@ int main(void)
 	mem_end = palloc_init();
 	malloc_init();
 	paging_init(mem_end);
+	trace_init();
+	prof_init();
 
 #ifdef USERPROG
 	tss_init();
@@ -154,16 +161,29 @@ paging_init(uint64_t mem_end)
 	extern char start, _end_kernel_text;
 	// Maps physical address [0 ~ mem_end] to
 	//   [LOADER_KERN_BASE ~ LOADER_KERN_BASE + mem_end].
-	for (uint64_t pa = 0; pa < mem_end; pa += PGSIZE)
+	// Every whole 2 MB region that does not overlap the read-only
+	// kernel text is mapped by a single huge PDE, which needs no page
+	// table and a single TLB entry.
+	for (uint64_t pa = 0; pa < mem_end;)
 	{
 		uint64_t va = (uint64_t)ptov(pa);
 
 		perm = PTE_P | PTE_W;
+		if (pa % HUGE_PGSIZE == 0 && pa + HUGE_PGSIZE <= mem_end
+			&& (va + HUGE_PGSIZE <= (uint64_t)&start || va >= (uint64_t)&_end_kernel_text))
+		{
+			if ((pte = pml4_pde_walk(pml4, va, 1)) != NULL)
+				*pte = pa | perm | PTE_PS;
+			pa += HUGE_PGSIZE;
+			continue;
+		}
+
 		if ((uint64_t)&start <= va && va < (uint64_t)&_end_kernel_text)
 			perm &= ~PTE_W;
 
 		if ((pte = pml4e_walk(pml4, va, 1)) != NULL)
 			*pte = pa | perm;
+		pa += PGSIZE;
 	}
 
 	// reload cr3
@@ -228,11 +248,35 @@ parse_options(char **argv)
 			random_init(atoi(value));
 		else if (!strcmp(name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp(name, "-lockstat"))
+			lockstat_enabled = true;
+		else if (!strcmp(name, "-prof"))
+		{
+			prof_requested = true;
+			prof_hz = value != NULL ? atoi(value) : TIMER_FREQ;
+		}
+		else if (!strcmp(name, "-trace"))
+		{
+			trace_requested = true;
+			trace_file = value;
+		}
 #ifdef USERPROG
 		else if (!strcmp(name, "-ul"))
 			user_page_limit = atoi(value);
+		else if (!strcmp(name, "-hp"))
+			user_huge_pages = true;
 		else if (!strcmp(name, "-threads-tests"))
 			thread_tests = true;
+#endif
+#ifdef VM
+		else if (!strcmp(name, "-fa"))
+		{
+			vm_fault_around_pages = atoi(value);
+			if (vm_fault_around_pages > FAULT_AROUND_MAX)
+				vm_fault_around_pages = FAULT_AROUND_MAX;
+		}
+		else if (!strcmp(name, "-zs"))
+			zswap_max_pages = atoi(value);
 #endif
 		else
 			PANIC("unknown option `%s' (use -h for help)", name);
@@ -340,8 +384,19 @@ usage(void)
 		   "  -f                 Format file system disk during startup.\n"
 		   "  -rs=SEED           Set random number seed to SEED.\n"
 		   "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+		   "  -lockstat          Print lock contention statistics at power off.\n"
+		   "  -prof[=HZ]         Sample running code HZ times per second (at most\n"
+		   "                     10 times per timer tick); print the profile at\n"
+		   "                     power off for utils/pintos-prof.\n"
+		   "  -trace[=FILE]      Trace kernel events; dump them at power off\n"
+		   "                     to the console, or to FILE in the file system.\n"
 #ifdef USERPROG
 		   "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+		   "  -hp                Back large zero-filled user segments with 2 MB pages.\n"
+#endif
+#ifdef VM
+		   "  -fa=PAGES          Map up to PAGES pages per file-backed fault.\n"
+		   "  -zs=PAGES          Keep up to PAGES pages of compressed swap (0=off).\n"
 #endif
 	);
 	power_off();
@@ -351,6 +406,8 @@ usage(void)
    as long as we're running on Bochs or QEMU. */
 void power_off(void)
 {
+	trace_dump();
+	prof_dump();
 #ifdef FILESYS
 	filesys_done();
 #endif
@@ -358,6 +415,7 @@ void power_off(void)
 	print_stats();
 
 	printf("Powering off...\n");
+	serial_flush(); /* Send console output still in the transmit ring. */
 	outw(0x604, 0x2000); /* Poweroff command for qemu */
 	for (;;)
 		;
@@ -374,7 +432,12 @@ print_stats(void)
 #endif
 	console_print_stats();
 	kbd_print_stats();
+	kmem_print_stats();
+	synch_print_stats();
 #ifdef USERPROG
 	exception_print_stats();
 #endif
+#ifdef VM
+	zswap_print_stats();
+#endif
 }
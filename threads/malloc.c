@@ -5,7 +5,9 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
@@ -32,7 +34,23 @@
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.
+
+   free() also accepts objects of the caches in slab.c, which it
+   recognizes by the magic number at the start of their page.
+
+   In front of each descriptor's free list sits a per-CPU
+   "magazine", a small stack of free blocks that malloc() and free()
+   use with interrupts turned off instead of taking the descriptor
+   lock.  Blocks in a magazine still count as in use in their arena.
+   The magazine goes to the free list for a batch of MAG_BATCH blocks
+   when it runs empty and gives that many back when it fills up. */
+
+/* Number of blocks a magazine holds. */
+#define MAG_SIZE 16
+
+/* Number of blocks moved between a magazine and its free list. */
+#define MAG_BATCH 8
 
 /* Descriptor. */
 struct desc {
@@ -40,6 +58,11 @@ struct desc {
 	size_t blocks_per_arena;    /* Number of blocks in an arena. */
 	struct list free_list;      /* List of free blocks. */
 	struct lock lock;           /* Lock. */
+	char lock_name[16];         /* Name of LOCK, e.g. "malloc 16". */
+
+	/* Magazine, accessed with interrupts off. */
+	struct block *mag[MAG_SIZE]; /* Free blocks, in use by arena. */
+	size_t mag_cnt;             /* Number of blocks in MAG. */
 };
 
 /* Magic number for detecting arena corruption. */
@@ -63,6 +86,8 @@ static size_t desc_cnt;         /* Number of descriptors. */
 
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static bool mag_refill (struct desc *);
+static void mag_drain (struct desc *);
 
 /* Initializes the malloc() descriptors. */
 void
@@ -75,7 +100,9 @@ malloc_init (void) {
 		d->block_size = block_size;
 		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
 		list_init (&d->free_list);
-		lock_init (&d->lock);
+		snprintf (d->lock_name, sizeof d->lock_name, "malloc %zu", block_size);
+		lock_init_named (&d->lock, d->lock_name);
+		d->mag_cnt = 0;
 	}
 }
 
@@ -92,11 +119,12 @@ malloc (size_t size) {
 		return NULL;
 
 	/* Find the smallest descriptor that satisfies a SIZE-byte
-	   request. */
-	for (d = descs; d < descs + desc_cnt; d++)
-		if (d->block_size >= size)
-			break;
-	if (d == descs + desc_cnt) {
+	   request.  Descriptor I holds blocks of 16 << I bytes. */
+	if (size <= 16)
+		d = descs;
+	else
+		d = descs + (64 - __builtin_clzl (size - 1)) - 4;
+	if (d >= descs + desc_cnt) {
 		/* SIZE is too big for any descriptor.
 		   Allocate enough pages to hold SIZE plus an arena. */
 		size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
@@ -112,35 +140,16 @@ malloc (size_t size) {
 		return a + 1;
 	}
 
-	lock_acquire (&d->lock);
-
-	/* If the free list is empty, create a new arena. */
-	if (list_empty (&d->free_list)) {
-		size_t i;
-
-		/* Allocate a page. */
-		a = palloc_get_page (0);
-		if (a == NULL) {
-			lock_release (&d->lock);
+	/* Take a block from the magazine, refilling it if empty. */
+	for (;;) {
+		enum intr_level old_level = intr_disable ();
+		b = d->mag_cnt > 0 ? d->mag[--d->mag_cnt] : NULL;
+		intr_set_level (old_level);
+		if (b != NULL)
+			return b;
+		if (!mag_refill (d))
 			return NULL;
-		}
-
-		/* Initialize arena and add its blocks to the free list. */
-		a->magic = ARENA_MAGIC;
-		a->desc = d;
-		a->free_cnt = d->blocks_per_arena;
-		for (i = 0; i < d->blocks_per_arena; i++) {
-			struct block *b = arena_to_block (a, i);
-			list_push_back (&d->free_list, &b->free_elem);
-		}
 	}
-
-	/* Get a block from free list and return it. */
-	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-	a = block_to_arena (b);
-	a->free_cnt--;
-	lock_release (&d->lock);
-	return b;
 }
 
 /* Allocates and return A times B bytes initialized to zeroes.
@@ -200,7 +209,11 @@ realloc (void *old_block, size_t new_size) {
    malloc(), calloc(), or realloc(). */
 void
 free (void *p) {
-	if (p != NULL) {
+	struct kmem_cache *c;
+
+	if (p != NULL && (c = kmem_cache_of (p)) != NULL)
+		kmem_cache_free (c, p);
+	else if (p != NULL) {
 		struct block *b = p;
 		struct arena *a = block_to_arena (b);
 		struct desc *d = a->desc;
@@ -213,24 +226,17 @@ free (void *p) {
 			memset (b, 0xcc, d->block_size);
 #endif
 
-			lock_acquire (&d->lock);
-
-			/* Add block to free list. */
-			list_push_front (&d->free_list, &b->free_elem);
-
-			/* If the arena is now entirely unused, free it. */
-			if (++a->free_cnt >= d->blocks_per_arena) {
-				size_t i;
-
-				ASSERT (a->free_cnt == d->blocks_per_arena);
-				for (i = 0; i < d->blocks_per_arena; i++) {
-					struct block *b = arena_to_block (a, i);
-					list_remove (&b->free_elem);
-				}
-				palloc_free_page (a);
+			/* Put block in the magazine, draining it if full. */
+			for (;;) {
+				enum intr_level old_level = intr_disable ();
+				bool done = d->mag_cnt < MAG_SIZE;
+				if (done)
+					d->mag[d->mag_cnt++] = b;
+				intr_set_level (old_level);
+				if (done)
+					break;
+				mag_drain (d);
 			}
-
-			lock_release (&d->lock);
 		} else {
 			/* It's a big block.  Free its pages. */
 			palloc_free_multiple (a, a->free_cnt);
@@ -239,6 +245,97 @@ free (void *p) {
 	}
 }
 
+/* Moves up to MAG_BATCH blocks from D's free list into its
+   magazine, creating a new arena if the free list is empty.
+   Returns false if memory is not available. */
+static bool
+mag_refill (struct desc *d) {
+	struct block *blocks[MAG_BATCH];
+	enum intr_level old_level;
+	size_t cnt, i;
+
+	lock_acquire (&d->lock);
+
+	/* If the free list is empty, create a new arena. */
+	if (list_empty (&d->free_list)) {
+		struct arena *a = palloc_get_page (0);
+		if (a == NULL) {
+			lock_release (&d->lock);
+			return false;
+		}
+
+		/* Initialize arena and add its blocks to the free list. */
+		a->magic = ARENA_MAGIC;
+		a->desc = d;
+		a->free_cnt = d->blocks_per_arena;
+		for (i = 0; i < d->blocks_per_arena; i++) {
+			struct block *b = arena_to_block (a, i);
+			list_push_back (&d->free_list, &b->free_elem);
+		}
+	}
+
+	/* Get blocks from free list. */
+	for (cnt = 0; cnt < MAG_BATCH && !list_empty (&d->free_list); cnt++) {
+		struct block *b = list_entry (list_pop_front (&d->free_list),
+				struct block, free_elem);
+		block_to_arena (b)->free_cnt--;
+		blocks[cnt] = b;
+	}
+
+	/* Someone may have filled the magazine meanwhile; whatever does
+	   not fit goes back on the free list. */
+	old_level = intr_disable ();
+	for (i = 0; i < cnt && d->mag_cnt < MAG_SIZE; i++)
+		d->mag[d->mag_cnt++] = blocks[i];
+	intr_set_level (old_level);
+	for (; i < cnt; i++) {
+		block_to_arena (blocks[i])->free_cnt++;
+		list_push_front (&d->free_list, &blocks[i]->free_elem);
+	}
+
+	lock_release (&d->lock);
+	return true;
+}
+
+/* Returns up to MAG_BATCH blocks from D's magazine to its free
+   list, giving arenas that become entirely unused back to the page
+   allocator. */
+static void
+mag_drain (struct desc *d) {
+	struct block *blocks[MAG_BATCH];
+	enum intr_level old_level;
+	size_t cnt, i;
+
+	lock_acquire (&d->lock);
+
+	old_level = intr_disable ();
+	for (cnt = 0; cnt < MAG_BATCH && d->mag_cnt > 0; cnt++)
+		blocks[cnt] = d->mag[--d->mag_cnt];
+	intr_set_level (old_level);
+
+	for (i = 0; i < cnt; i++) {
+		struct block *b = blocks[i];
+		struct arena *a = block_to_arena (b);
+
+		/* Add block to free list. */
+		list_push_front (&d->free_list, &b->free_elem);
+
+		/* If the arena is now entirely unused, free it. */
+		if (++a->free_cnt >= d->blocks_per_arena) {
+			size_t j;
+
+			ASSERT (a->free_cnt == d->blocks_per_arena);
+			for (j = 0; j < d->blocks_per_arena; j++) {
+				struct block *b = arena_to_block (a, j);
+				list_remove (&b->free_elem);
+			}
+			palloc_free_page (a);
+		}
+	}
+
+	lock_release (&d->lock);
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b) {
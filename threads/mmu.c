@@ -2,6 +2,7 @@
 #include <stddef.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
@@ -23,6 +24,9 @@ pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 			} else
 				return NULL;
 		}
+		/* A huge page has no page table; its PDE is the entry. */
+		if (pdp[idx] & PTE_PS)
+			return create ? NULL : &pdp[idx];
 		return (uint64_t *) ptov (PTE_ADDR (pdp[idx]) + 8 * PTX (va));
 	}
 	return NULL;
@@ -60,7 +64,9 @@ pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
  * If PML4E does not have a page table for VADDR, behavior depends
  * on CREATE.  If CREATE is true, then a new page table is
  * created and a pointer into it is returned.  Otherwise, a null
- * pointer is returned. */
+ * pointer is returned.
+ * If VADDR lies in a 2 MB page, the PDE that maps it is returned
+ * instead (see is_huge_pte()), or a null pointer if CREATE is true. */
 uint64_t *
 pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 	uint64_t *pte = NULL;
@@ -88,13 +94,63 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 	return pte;
 }
 
+/* Returns the table that entry IDX of TABLE points to, allocating
+ * an empty one if it is not present and CREATE is true. */
+static uint64_t *
+next_level (uint64_t *table, int idx, int create) {
+	if (!(table[idx] & PTE_P)) {
+		uint64_t *new_page;
+
+		if (!create || (new_page = palloc_get_page (PAL_ZERO)) == NULL)
+			return NULL;
+		table[idx] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+	}
+	return ptov (PTE_ADDR (table[idx]));
+}
+
+/* Returns the address of the page directory entry for virtual
+ * address VA in PML4, which maps VA's 2 MB region either through a
+ * page table or directly as a huge page.  Missing upper level tables
+ * are created if CREATE is true; otherwise a null pointer is
+ * returned for them. */
+uint64_t *
+pml4_pde_walk (uint64_t *pml4, const uint64_t va, int create) {
+	uint64_t *pdpe, *pde;
+
+	if (pml4 == NULL
+			|| (pdpe = next_level (pml4, PML4 (va), create)) == NULL
+			|| (pde = next_level (pdpe, PDPE (va), create)) == NULL)
+		return NULL;
+	return &pde[PDX (va)];
+}
+
+/* Pool of destroyed pml4s, kept for reuse by pml4_create().  The
+ * kernel entries of each are still a copy of base_pml4's, which
+ * does not change after boot, and its only user entry, entry 0,
+ * links it to the next pml4 in the pool. */
+#define PML4_POOL_MAX 8
+static uint64_t *pml4_pool;
+static size_t pml4_pool_cnt;
+
 /* Creates a new page map level 4 (pml4) has mappings for kernel
  * virtual addresses, but none for user virtual addresses.
  * Returns the new page directory, or a null pointer if memory
  * allocation fails. */
 uint64_t *
 pml4_create (void) {
-	uint64_t *pml4 = palloc_get_page (0);
+	enum intr_level old_level = intr_disable ();
+	uint64_t *pml4 = pml4_pool;
+	if (pml4) {
+		pml4_pool = (uint64_t *) pml4[0];
+		pml4_pool_cnt--;
+	}
+	intr_set_level (old_level);
+
+	if (pml4) {
+		pml4[0] = 0;
+		return pml4;
+	}
+	pml4 = palloc_get_page (0);
 	if (pml4)
 		memcpy (pml4, base_pml4, PGSIZE);
 	return pml4;
@@ -122,10 +178,18 @@ pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
-			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
+		if (((uint64_t) pte) & PTE_P) {
+			if (((uint64_t) pte) & PTE_PS) {
+				/* A huge page is passed to FUNC as its PDE. */
+				void *va = (void *) (((uint64_t) pml4_index << PML4SHIFT) |
+									 ((uint64_t) pdp_index << PDPESHIFT) |
+									 ((uint64_t) i << PDXSHIFT));
+				if (!func (&pdp[i], va, aux))
+					return false;
+			} else if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
 					pml4_index, pdp_index, i))
 				return false;
+		}
 	}
 	return true;
 }
@@ -169,8 +233,12 @@ static void
 pgdir_destroy (uint64_t *pdp) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
-			pt_destroy (PTE_ADDR (pte));
+		if (((uint64_t) pte) & PTE_P) {
+			if (((uint64_t) pte) & PTE_PS)
+				palloc_free_huge_page ((void *) PTE_ADDR (pte));
+			else
+				pt_destroy (PTE_ADDR (pte));
+		}
 	}
 	palloc_free_page ((void *) pdp);
 }
@@ -196,7 +264,18 @@ pml4_destroy (uint64_t *pml4) {
 	uint64_t *pdpe = ptov ((uint64_t *) pml4[0]);
 	if (((uint64_t) pdpe) & PTE_P)
 		pdpe_destroy ((void *) PTE_ADDR (pdpe));
-	palloc_free_page ((void *) pml4);
+
+	enum intr_level old_level = intr_disable ();
+	if (pml4_pool_cnt < PML4_POOL_MAX) {
+		pml4[0] = (uint64_t) pml4_pool;
+		pml4_pool = pml4;
+		pml4_pool_cnt++;
+		pml4 = NULL;
+	}
+	intr_set_level (old_level);
+
+	if (pml4)
+		palloc_free_page ((void *) pml4);
 }
 
 /* Loads page directory PD into the CPU's page directory base
@@ -216,8 +295,11 @@ pml4_get_page (uint64_t *pml4, const void *uaddr) {
 
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) uaddr, 0);
 
-	if (pte && (*pte & PTE_P))
+	if (pte && (*pte & PTE_P)) {
+		if (*pte & PTE_PS)
+			return ptov (PTE_ADDR (*pte)) + ((uint64_t) uaddr & HUGE_PGMASK);
 		return ptov (PTE_ADDR (*pte)) + pg_ofs (uaddr);
+	}
 	return NULL;
 }
 
@@ -243,6 +325,29 @@ pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
 	return pte != NULL;
 }
 
+/* Adds a 2 MB mapping in PML4 from user virtual address UPAGE to the
+ * huge page at kernel virtual address KPAGE, as obtained from
+ * palloc_get_huge_page().  Both must be 2 MB aligned, and no part of
+ * the 2 MB region at UPAGE may already be mapped.
+ * If WRITABLE is true, the new page is read/write;
+ * otherwise it is read-only.
+ * Returns true if successful, false if the region is already in use
+ * or memory allocation failed. */
+bool
+pml4_set_huge_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
+	ASSERT (((uint64_t) upage & HUGE_PGMASK) == 0);
+	ASSERT (((uint64_t) kpage & HUGE_PGMASK) == 0);
+	ASSERT (is_user_vaddr (upage));
+	ASSERT (pml4 != base_pml4);
+
+	uint64_t *pde = pml4_pde_walk (pml4, (uint64_t) upage, 1);
+
+	if (pde == NULL || (*pde & PTE_P))
+		return false;
+	*pde = vtop (kpage) | PTE_P | PTE_PS | (rw ? PTE_W : 0) | PTE_U;
+	return true;
+}
+
 /* Marks user virtual page UPAGE "not present" in page
  * directory PD.  Later accesses to the page will fault.  Other
  * bits in the page table entry are preserved.
@@ -2,14 +2,16 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
+#include "threads/pte.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -24,13 +26,72 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is a binary buddy allocator.  Free memory is kept as
+   blocks of 2**ORDER pages, aligned to their size in physical
+   memory, on one free list per order.  An allocation splits the
+   smallest large enough block, and a free merges a block with its
+   equally sized neighbour ("buddy") for as long as that is free
+   too, so both take O(log n) time whatever the pool's size or
+   fragmentation.  Requests that are not a power of two take the
+   next larger block and give back its tail.  The used_map bitmap
+   is kept only to check for double frees.
+
+   Single pages, by far the most common request, are served from a
+   per-CPU "magazine" of free pages kept in front of each pool.
+   Pages in a magazine count as allocated in the buddy system, so
+   popping or pushing one is just an array access.  An empty
+   magazine is refilled, and a full one drained, MAG_BATCH pages at
+   a time.  Pintos runs on a single CPU, so there is just one
+   magazine per pool, and the pool is protected by turning
+   interrupts off: no operation is long enough to need a lock, and
+   palloc_free_page() is called with interrupts already off when
+   the scheduler frees a dying thread.
+
+   Finally, each pool keeps a stack of pages that the idle thread
+   has zeroed ahead of time, through palloc_zero_idle(), so that
+   PAL_ZERO requests for single pages skip the memset(). */
+
+/* Largest block order, a 1 GB block. */
+#define MAX_ORDER 18
+
+/* Order of a 2 MB huge page. */
+#define HUGE_ORDER 9
+
+/* Order field of a page that does not start a free block. */
+#define NO_ORDER 0xff
+
+/* Number of pages a magazine holds. */
+#define MAG_SIZE 32
+
+/* Number of pages moved between a magazine and its pool at once. */
+#define MAG_BATCH 16
+
+/* Number of pre-zeroed pages each pool keeps. */
+#define ZERO_SIZE 32
+
+/* Buddy bookkeeping for a page. */
+struct buddy_page {
+	struct list_elem elem;          /* Element in a free list. */
+	uint8_t order;                  /* Block order if free head. */
+};
 
 /* A memory pool. */
 struct pool {
-	struct lock lock;               /* Mutual exclusion. */
 	struct bitmap *used_map;        /* Bitmap of free pages. */
+	struct buddy_page *pages;       /* Bookkeeping for each page. */
 	uint8_t *base;                  /* Base of pool. */
+	size_t page_cnt;                /* Number of pages in pool. */
+	struct list free[MAX_ORDER + 1]; /* Free blocks of each order. */
+
+	/* Magazine. */
+	void *mag[MAG_SIZE];            /* Free pages, marked used. */
+	size_t mag_cnt;                 /* Number of pages in MAG. */
+
+	/* Pre-zeroed pages. */
+	void *zeroed[ZERO_SIZE];        /* Zeroed free pages, marked used. */
+	size_t zero_cnt;                /* Number of pages in ZEROED. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -42,6 +103,14 @@ static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static struct pool *pool_of (void *page);
+static size_t buddy_alloc (struct pool *, unsigned order);
+static size_t buddy_alloc_pages (struct pool *, size_t page_cnt);
+static void buddy_free (struct pool *, size_t page_idx, unsigned order);
+static void buddy_free_pages (struct pool *, size_t page_idx, size_t page_cnt);
+static void mag_refill (struct pool *);
+static size_t mag_drain (struct pool *, size_t page_cnt);
+static size_t pool_drain (struct pool *);
 
 /* multiboot info */
 struct multiboot_info {
@@ -219,16 +288,16 @@ split:
 			else
 				NOT_REACHED ();
 
-			pool_end = pool->base + bitmap_size (pool->used_map) * PGSIZE;
+			pool_end = pool->base + pool->page_cnt * PGSIZE;
 			page_idx = pg_no (start) - pg_no (pool->base);
 			if ((uint64_t) pool_end < end) {
 				page_cnt = ((uint64_t) pool_end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				buddy_free_pages (pool, page_idx, page_cnt);
 				start = (uint64_t) pool_end;
 				goto split;
 			} else {
 				page_cnt = ((uint64_t) end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				buddy_free_pages (pool, page_idx, page_cnt);
 			}
 		}
 	}
@@ -262,12 +331,18 @@ palloc_init (void) {
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
-
-	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
+	enum intr_level old_level;
+	size_t page_idx;
 	void *pages;
 
+	/* Pages parked in the magazine may be exactly what is missing,
+	   so give them back and look once more before failing. */
+	old_level = intr_disable ();
+	page_idx = buddy_alloc_pages (pool, page_cnt);
+	if (page_idx == BITMAP_ERROR && pool_drain (pool) > 0)
+		page_idx = buddy_alloc_pages (pool, page_cnt);
+	intr_set_level (old_level);
+
 	if (page_idx != BITMAP_ERROR)
 		pages = pool->base + PGSIZE * page_idx;
 	else
@@ -293,56 +368,189 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
    FLAGS, in which case the kernel panics. */
 void *
 palloc_get_page (enum palloc_flags flags) {
-	return palloc_get_multiple (flags, 1);
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	enum intr_level old_level;
+	void *page = NULL;
+	bool zeroed = false;
+
+	/* Zeroed pages are for PAL_ZERO, but rather than fail, any
+	   request may have the last of them. */
+	old_level = intr_disable ();
+	if ((flags & PAL_ZERO) && pool->zero_cnt > 0)
+		page = pool->zeroed[--pool->zero_cnt], zeroed = true;
+	else {
+		if (pool->mag_cnt == 0)
+			mag_refill (pool);
+		if (pool->mag_cnt > 0)
+			page = pool->mag[--pool->mag_cnt];
+		else if (pool->zero_cnt > 0)
+			page = pool->zeroed[--pool->zero_cnt], zeroed = true;
+	}
+	intr_set_level (old_level);
+
+	if (page) {
+		if ((flags & PAL_ZERO) && !zeroed)
+			memset (page, 0, PGSIZE);
+	} else {
+		if (flags & PAL_ASSERT)
+			PANIC ("palloc_get: out of pages");
+	}
+
+	return page;
+}
+
+/* Obtains a 2 MB huge page, HUGE_PGCNT contiguous free pages whose
+   kernel virtual (and so physical) address is 2 MB aligned, and
+   returns its kernel virtual address.  FLAGS are interpreted as by
+   palloc_get_multiple().  Free it with palloc_free_huge_page(). */
+void *
+palloc_get_huge_page (enum palloc_flags flags) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	enum intr_level old_level;
+	size_t page_idx;
+	void *pages = NULL;
+
+	/* Buddy blocks are aligned to their size, so a block of
+	   HUGE_ORDER is exactly a huge page. */
+	old_level = intr_disable ();
+	page_idx = buddy_alloc (pool, HUGE_ORDER);
+	if (page_idx == BITMAP_ERROR && pool_drain (pool) > 0)
+		page_idx = buddy_alloc (pool, HUGE_ORDER);
+	if (page_idx != BITMAP_ERROR) {
+		bitmap_set_multiple (pool->used_map, page_idx, HUGE_PGCNT, true);
+		pages = pool->base + PGSIZE * page_idx;
+	}
+	intr_set_level (old_level);
+
+	if (pages) {
+		if (flags & PAL_ZERO)
+			memset (pages, 0, HUGE_PGSIZE);
+	} else {
+		if (flags & PAL_ASSERT)
+			PANIC ("palloc_get_huge_page: out of pages");
+	}
+	return pages;
+}
+
+/* Frees the huge page at PAGE. */
+void
+palloc_free_huge_page (void *page) {
+	ASSERT (((uint64_t) page & HUGE_PGMASK) == 0);
+	palloc_free_multiple (page, HUGE_PGCNT);
 }
 
 /* Frees the PAGE_CNT pages starting at PAGES. */
 void
 palloc_free_multiple (void *pages, size_t page_cnt) {
 	struct pool *pool;
+	enum intr_level old_level;
 	size_t page_idx;
 
 	ASSERT (pg_ofs (pages) == 0);
 	if (pages == NULL || page_cnt == 0)
 		return;
 
-	if (page_from_pool (&kernel_pool, pages))
-		pool = &kernel_pool;
-	else if (page_from_pool (&user_pool, pages))
-		pool = &user_pool;
-	else
-		NOT_REACHED ();
-
+	pool = pool_of (pages);
 	page_idx = pg_no (pages) - pg_no (pool->base);
 
 #ifndef NDEBUG
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	old_level = intr_disable ();
+	buddy_free_pages (pool, page_idx, page_cnt);
+	intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
 void
 palloc_free_page (void *page) {
-	palloc_free_multiple (page, 1);
+	struct pool *pool;
+	enum intr_level old_level;
+
+	ASSERT (pg_ofs (page) == 0);
+	if (page == NULL)
+		return;
+
+	pool = pool_of (page);
+#ifndef NDEBUG
+	memset (page, 0xcc, PGSIZE);
+#endif
+	ASSERT (bitmap_test (pool->used_map, pg_no (page) - pg_no (pool->base)));
+
+	old_level = intr_disable ();
+	if (pool->mag_cnt == MAG_SIZE)
+		mag_drain (pool, MAG_BATCH);
+	pool->mag[pool->mag_cnt++] = page;
+	intr_set_level (old_level);
+}
+
+/* Zeroes a free page ahead of time for a later PAL_ZERO request.
+   Called by the idle thread, with interrupts on, so that the
+   memset() takes only time nobody else wanted.  Returns false if
+   there was nothing to do, because every pool already holds
+   ZERO_SIZE zeroed pages or has no free page left. */
+bool
+palloc_zero_idle (void) {
+	struct pool *pools[] = { &kernel_pool, &user_pool };
+	enum intr_level old_level;
+	size_t i;
+
+	for (i = 0; i < sizeof pools / sizeof *pools; i++) {
+		struct pool *pool = pools[i];
+		void *page = NULL;
+
+		old_level = intr_disable ();
+		if (pool->zero_cnt < ZERO_SIZE) {
+			if (pool->mag_cnt == 0)
+				mag_refill (pool);
+			if (pool->mag_cnt > 0)
+				page = pool->mag[--pool->mag_cnt];
+		}
+		intr_set_level (old_level);
+		if (page == NULL)
+			continue;
+
+		memset (page, 0, PGSIZE);
+
+		old_level = intr_disable ();
+		if (pool->zero_cnt < ZERO_SIZE) {
+			pool->zeroed[pool->zero_cnt++] = page;
+			page = NULL;
+		}
+		intr_set_level (old_level);
+		if (page != NULL)
+			palloc_free_page (page);
+		return true;
+	}
+	return false;
 }
 
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
+  /* We'll put the pool's used_map at its base, followed by the
+     buddy bookkeeping.  Calculate the space needed for them
      and subtract it from the pool's size. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
-	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
+	size_t bm_size = ROUND_UP (bitmap_buf_size (pgcnt), sizeof (void *));
+	size_t bm_pages = DIV_ROUND_UP (bm_size
+			+ pgcnt * sizeof (struct buddy_page), PGSIZE) * PGSIZE;
+	size_t i;
 
-	lock_init(&p->lock);
-	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
+	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_size);
+	p->pages = (struct buddy_page *) ((uint8_t *) *bm_base + bm_size);
 	p->base = (void *) start;
+	p->page_cnt = pgcnt;
+	for (i = 0; i <= MAX_ORDER; i++)
+		list_init (&p->free[i]);
+	p->mag_cnt = 0;
+	p->zero_cnt = 0;
 
 	// Mark all to unusable.
 	bitmap_set_all(p->used_map, true);
+	for (i = 0; i < pgcnt; i++)
+		p->pages[i].order = NO_ORDER;
 
 	*bm_base += bm_pages;
 }
@@ -353,6 +561,180 @@ static bool
 page_from_pool (const struct pool *pool, void *page) {
 	size_t page_no = pg_no (page);
 	size_t start_page = pg_no (pool->base);
-	size_t end_page = start_page + bitmap_size (pool->used_map);
+	size_t end_page = start_page + pool->page_cnt;
 	return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns the pool that PAGE was allocated from. */
+static struct pool *
+pool_of (void *page) {
+	if (page_from_pool (&kernel_pool, page))
+		return &kernel_pool;
+	else if (page_from_pool (&user_pool, page))
+		return &user_pool;
+	else
+		NOT_REACHED ();
+}
+
+/* Returns the index of the buddy of the block of ORDER at
+   PAGE_IDX in POOL, or BITMAP_ERROR if the buddy would lie
+   (partly) outside the pool.  Blocks are aligned by physical page
+   number, not by index, so that a block of HUGE_ORDER is a huge
+   page. */
+static size_t
+buddy_of (const struct pool *pool, size_t page_idx, unsigned order) {
+	size_t base_no = pg_no (pool->base);
+	size_t buddy_no = (base_no + page_idx) ^ ((size_t) 1 << order);
+
+	if (buddy_no < base_no
+			|| buddy_no - base_no + ((size_t) 1 << order) > pool->page_cnt)
+		return BITMAP_ERROR;
+	return buddy_no - base_no;
+}
+
+/* Puts the free block of ORDER at PAGE_IDX on POOL's free list. */
+static void
+free_list_push (struct pool *pool, size_t page_idx, unsigned order) {
+	pool->pages[page_idx].order = order;
+	list_push_front (&pool->free[order], &pool->pages[page_idx].elem);
+}
+
+/* Takes a block of 2**ORDER pages off POOL's free lists, splitting a
+   larger block if needed, and returns its index, or BITMAP_ERROR if
+   there is none.  Does not touch used_map.  Interrupts must be
+   off. */
+static size_t
+buddy_alloc (struct pool *pool, unsigned order) {
+	struct buddy_page *bp;
+	size_t page_idx;
+	unsigned k;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (k = order; k <= MAX_ORDER && list_empty (&pool->free[k]); k++)
+		continue;
+	if (k > MAX_ORDER)
+		return BITMAP_ERROR;
+
+	bp = list_entry (list_pop_front (&pool->free[k]), struct buddy_page, elem);
+	bp->order = NO_ORDER;
+	page_idx = bp - pool->pages;
+
+	/* Give back the upper half until the block is small enough. */
+	while (k > order) {
+		k--;
+		free_list_push (pool, page_idx + ((size_t) 1 << k), k);
+	}
+	return page_idx;
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first, or BITMAP_ERROR.  Interrupts must be off. */
+static size_t
+buddy_alloc_pages (struct pool *pool, size_t page_cnt) {
+	unsigned order = 0;
+	size_t page_idx;
+
+	while (((size_t) 1 << order) < page_cnt)
+		if (++order > MAX_ORDER)
+			return BITMAP_ERROR;
+
+	page_idx = buddy_alloc (pool, order);
+	if (page_idx == BITMAP_ERROR)
+		return BITMAP_ERROR;
+
+	/* Return the unused tail of the block. */
+	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+	buddy_free_pages (pool, page_idx + page_cnt,
+			((size_t) 1 << order) - page_cnt);
+	return page_idx;
+}
+
+/* Returns the block of ORDER at PAGE_IDX to POOL, merging it with
+   its buddy for as long as the buddy is free.  Does not touch
+   used_map.  Interrupts must be off. */
+static void
+buddy_free (struct pool *pool, size_t page_idx, unsigned order) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (order < MAX_ORDER) {
+		size_t buddy_idx = buddy_of (pool, page_idx, order);
+		if (buddy_idx == BITMAP_ERROR
+				|| pool->pages[buddy_idx].order != order)
+			break;
+
+		list_remove (&pool->pages[buddy_idx].elem);
+		pool->pages[buddy_idx].order = NO_ORDER;
+		if (buddy_idx < page_idx)
+			page_idx = buddy_idx;
+		order++;
+	}
+	free_list_push (pool, page_idx, order);
+}
+
+/* Frees the PAGE_CNT pages at PAGE_IDX in POOL, which need not be a
+   single block, by cutting them into the largest aligned blocks
+   they contain.  Interrupts must be off. */
+static void
+buddy_free_pages (struct pool *pool, size_t page_idx, size_t page_cnt) {
+	size_t base_no = pg_no (pool->base);
+
+	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	while (page_cnt > 0) {
+		unsigned order = 0;
+
+		while (order < MAX_ORDER
+				&& ((base_no + page_idx) & ((size_t) 1 << order)) == 0
+				&& ((size_t) 2 << order) <= page_cnt)
+			order++;
+		buddy_free (pool, page_idx, order);
+		page_idx += (size_t) 1 << order;
+		page_cnt -= (size_t) 1 << order;
+	}
+}
+
+/* Moves up to MAG_BATCH free pages from POOL into its empty
+   magazine.  Interrupts must be off. */
+static void
+mag_refill (struct pool *pool) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (pool->mag_cnt < MAG_BATCH) {
+		size_t page_idx = buddy_alloc (pool, 0);
+		if (page_idx == BITMAP_ERROR)
+			break;
+		bitmap_mark (pool->used_map, page_idx);
+		pool->mag[pool->mag_cnt++] = pool->base + PGSIZE * page_idx;
+	}
+}
+
+/* Returns up to PAGE_CNT pages from POOL's magazine to the buddy
+   system and returns the number returned. */
+static size_t
+mag_drain (struct pool *pool, size_t page_cnt) {
+	enum intr_level old_level = intr_disable ();
+	size_t cnt;
+
+	for (cnt = 0; cnt < page_cnt && pool->mag_cnt > 0; cnt++) {
+		void *page = pool->mag[--pool->mag_cnt];
+		buddy_free_pages (pool, pg_no (page) - pg_no (pool->base), 1);
+	}
+	intr_set_level (old_level);
+	return cnt;
+}
+
+/* Returns every page of POOL's magazine and zeroed stack to the
+   buddy system, for a request that they might otherwise block.
+   Returns the number of pages returned. */
+static size_t
+pool_drain (struct pool *pool) {
+	enum intr_level old_level = intr_disable ();
+	size_t cnt = mag_drain (pool, MAG_SIZE);
+
+	for (; pool->zero_cnt > 0; cnt++) {
+		void *page = pool->zeroed[--pool->zero_cnt];
+		buddy_free_pages (pool, pg_no (page) - pg_no (pool->base), 1);
+	}
+	intr_set_level (old_level);
+	return cnt;
+}
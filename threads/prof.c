@@ -0,0 +1,166 @@
+#include "threads/prof.h"
+#include <debug.h>
+#include <hash.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Sampling profiler.
+
+   Each sample is the interrupted rip, followed for kernel code
+   by the return addresses found by following the saved frame
+   pointers up the thread's kernel stack.  Samples are counted in
+   an open-addressed hash table keyed by thread, mode and call
+   stack, so a long run costs memory only for the distinct
+   stacks it sees.  A sample that finds no free slot within
+   PROF_PROBES probes is dropped and counted as such. */
+
+/* Size of the histogram in pages. */
+#define PROF_PAGES 32
+
+/* Most return addresses recorded per sample, including rip. */
+#define PROF_DEPTH 14
+
+/* Slots examined before a sample is dropped. */
+#define PROF_PROBES 16
+
+/* A distinct sample and how often it was seen. */
+struct prof_entry {
+	int32_t tid;                /* Interrupted thread. */
+	uint16_t user;              /* Interrupted in user mode? */
+	uint16_t depth;             /* Number of PCS in use. */
+	uintptr_t pcs[PROF_DEPTH];  /* rip, then return addresses. */
+	uint64_t count;             /* Times seen, 0 if the slot is free. */
+};
+
+/* Bytes of a struct prof_entry that identify it. */
+#define PROF_KEY_SIZE offsetof (struct prof_entry, count)
+
+bool prof_requested;
+unsigned prof_hz;
+bool prof_enabled;
+unsigned prof_rate = 1;
+
+static struct prof_entry *entries;
+static size_t entry_cap;        /* Number of entries, a power of 2. */
+static uint64_t sample_cnt;     /* Samples taken. */
+static uint64_t drop_cnt;       /* Samples dropped. */
+
+/* Starts sampling if it was requested on the command line.  Must
+   be called after the page allocator is initialized and before
+   the timer is, which runs at the sampling rate chosen here. */
+void
+prof_init (void) {
+	size_t cap;
+	unsigned rate;
+
+	if (!prof_requested)
+		return;
+
+	entries = palloc_get_multiple (PAL_ZERO, PROF_PAGES);
+	if (entries == NULL) {
+		printf ("prof: out of memory, profiling disabled\n");
+		return;
+	}
+	for (cap = 1; cap * 2 <= PROF_PAGES * PGSIZE / sizeof *entries; cap *= 2)
+		continue;
+	entry_cap = cap;
+
+	rate = prof_hz / TIMER_FREQ;
+	if (rate < 1)
+		rate = 1;
+	if (rate > PROF_RATE_MAX)
+		rate = PROF_RATE_MAX;
+	prof_rate = rate;
+	prof_hz = rate * TIMER_FREQ;
+	prof_enabled = true;
+}
+
+/* Fills E's call stack from the interrupt frame F. */
+static void
+walk_stack (struct prof_entry *e, const struct intr_frame *f) {
+	uintptr_t stack_end = (uintptr_t) pg_round_down (f->rsp) + PGSIZE;
+	uintptr_t frame = f->R.rbp;
+
+	e->pcs[e->depth++] = f->rip;
+	if (e->user)
+		return;
+
+	/* Stay within the kernel stack below the interrupted rsp,
+	   where every frame is above the one it was called from. */
+	while (e->depth < PROF_DEPTH
+			&& frame >= f->rsp && frame % sizeof (void *) == 0
+			&& frame + 2 * sizeof (void *) <= stack_end) {
+		void **fp = (void **) frame;
+
+		if (fp[1] == NULL)
+			break;
+		e->pcs[e->depth++] = (uintptr_t) fp[1];
+		if ((uintptr_t) fp[0] <= frame)
+			break;
+		frame = (uintptr_t) fp[0];
+	}
+}
+
+/* Records a sample of the code interrupted with frame F.  Called
+   by the timer interrupt handler. */
+void
+prof_sample (const struct intr_frame *f) {
+	struct prof_entry key;
+	size_t idx;
+	int i;
+
+	ASSERT (intr_context ());
+
+	memset (&key, 0, sizeof key);
+	key.tid = thread_current ()->tid;
+	key.user = (f->cs & 3) == 3;
+	walk_stack (&key, f);
+
+	sample_cnt++;
+	idx = hash_bytes (&key, PROF_KEY_SIZE);
+	for (i = 0; i < PROF_PROBES; i++, idx++) {
+		struct prof_entry *e = &entries[idx & (entry_cap - 1)];
+		if (e->count == 0) {
+			memcpy (e, &key, PROF_KEY_SIZE);
+			e->count = 1;
+			return;
+		}
+		if (!memcmp (e, &key, PROF_KEY_SIZE)) {
+			e->count++;
+			return;
+		}
+	}
+	drop_cnt++;
+}
+
+/* Stops sampling and prints the histogram to the console, one
+   distinct sample per line: count, tid, "k" or "u", and the call
+   stack, innermost first. */
+void
+prof_dump (void) {
+	size_t i;
+	int j;
+
+	if (!prof_enabled)
+		return;
+	prof_enabled = false;
+
+	printf ("prof: begin hz=%u samples=%llu dropped=%llu\n", prof_hz,
+			(unsigned long long) sample_cnt, (unsigned long long) drop_cnt);
+	for (i = 0; i < entry_cap; i++) {
+		const struct prof_entry *e = &entries[i];
+		if (e->count == 0)
+			continue;
+		printf ("%llu %d %c", (unsigned long long) e->count, e->tid,
+				e->user ? 'u' : 'k');
+		for (j = 0; j < e->depth; j++)
+			printf (" %#llx", (unsigned long long) e->pcs[j]);
+		printf ("\n");
+	}
+	printf ("prof: end\n");
+}
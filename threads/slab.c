@@ -0,0 +1,219 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* A slab allocator.
+
+   Each cache carves pages, called "slabs", into objects of its
+   exact size.  A slab starts with a header and a stack of the
+   indexes of its free objects, followed by the objects.  Keeping
+   the free list outside of the objects leaves free objects
+   untouched, so that they stay in the state the constructor put
+   them in.
+
+   Slabs with free objects are kept on the cache's partial list
+   and the others on its full list.  When a slab becomes entirely
+   free it is kept if it is the cache's only free slab and given
+   back to the page allocator otherwise, so that a cache that
+   hovers around a slab boundary does not keep allocating and
+   freeing pages. */
+
+/* Magic number for detecting slab corruption.  Its position
+   matches the magic number of malloc()'s arenas, so free() can
+   tell the two apart. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Cache. */
+struct kmem_cache {
+	const char *name;           /* For statistics. */
+	size_t obj_size;            /* Size of each object in bytes. */
+	size_t objs_per_slab;       /* Number of objects in a slab. */
+	size_t obj_ofs;             /* Offset of the first object in a slab. */
+	kmem_ctor_func *ctor;       /* Constructor, may be null. */
+	struct list partial;        /* Slabs with free objects. */
+	struct list full;           /* Slabs without free objects. */
+	size_t empty_cnt;           /* Entirely free slabs. */
+	struct lock lock;
+
+	/* Statistics. */
+	size_t slab_cnt;            /* Slabs. */
+	size_t active_cnt;          /* Objects in use. */
+	long long alloc_cnt;        /* Calls to kmem_cache_alloc(). */
+	long long free_cnt;         /* Calls to kmem_cache_free(). */
+};
+
+/* Slab header. */
+struct slab {
+	unsigned magic;             /* Always set to SLAB_MAGIC. */
+	struct kmem_cache *cache;   /* Owning cache. */
+	struct list_elem elem;      /* Element in partial or full list. */
+	size_t free_cnt;            /* Number of free objects. */
+	uint16_t free[];            /* Indexes of free objects. */
+};
+
+/* Our set of caches. */
+static struct kmem_cache caches[16];
+static size_t cache_cnt;
+
+/* Returns the IDX'th object of SLAB. */
+static void *
+slab_obj (struct slab *s, size_t idx) {
+	return (uint8_t *) s + s->cache->obj_ofs + idx * s->cache->obj_size;
+}
+
+/* Creates and returns a cache of SIZE-byte objects named NAME,
+   whose objects are initialized by CTOR, if non-null.  Objects
+   must fit in a page along with the slab header.  Panics if the
+   fixed set of caches is exhausted, because caches are only made
+   at initialization time. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, kmem_ctor_func *ctor) {
+	struct kmem_cache *c;
+	size_t n;
+
+	ASSERT (size > 0);
+	if (cache_cnt >= sizeof caches / sizeof *caches)
+		PANIC ("too many object caches");
+	c = &caches[cache_cnt++];
+
+	c->name = name;
+	c->obj_size = ROUND_UP (size, 8);
+	n = (PGSIZE - sizeof (struct slab)) / (c->obj_size + sizeof (uint16_t));
+	while (n > 0 && ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t), 8)
+			+ n * c->obj_size > PGSIZE)
+		n--;
+	ASSERT (n > 0);
+	c->objs_per_slab = n;
+	c->obj_ofs = ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t), 8);
+	c->ctor = ctor;
+	list_init (&c->partial);
+	list_init (&c->full);
+	c->empty_cnt = 0;
+	lock_init_named (&c->lock, name);
+	c->slab_cnt = c->active_cnt = 0;
+	c->alloc_cnt = c->free_cnt = 0;
+	return c;
+}
+
+/* Adds a new slab to cache C, which must be locked.  Returns false
+   if no page is available. */
+static bool
+cache_grow (struct kmem_cache *c) {
+	struct slab *s = palloc_get_page (0);
+	size_t i;
+
+	if (s == NULL)
+		return false;
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->free_cnt = c->objs_per_slab;
+	for (i = 0; i < c->objs_per_slab; i++) {
+		s->free[i] = c->objs_per_slab - 1 - i;
+		if (c->ctor != NULL)
+			c->ctor (slab_obj (s, i));
+	}
+	list_push_back (&c->partial, &s->elem);
+	c->slab_cnt++;
+	c->empty_cnt++;
+	return true;
+}
+
+/* Obtains and returns an object from cache C.
+   Returns a null pointer if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) {
+	struct slab *s;
+	void *obj;
+
+	lock_acquire (&c->lock);
+	if (list_empty (&c->partial) && !cache_grow (c)) {
+		lock_release (&c->lock);
+		return NULL;
+	}
+
+	s = list_entry (list_front (&c->partial), struct slab, elem);
+	if (s->free_cnt == c->objs_per_slab)
+		c->empty_cnt--;
+	obj = slab_obj (s, s->free[--s->free_cnt]);
+	if (s->free_cnt == 0) {
+		list_remove (&s->elem);
+		list_push_back (&c->full, &s->elem);
+	}
+	c->active_cnt++;
+	c->alloc_cnt++;
+	lock_release (&c->lock);
+	return obj;
+}
+
+/* Returns the slab that OBJ is in, or a null pointer if OBJ was not
+   allocated from a cache. */
+static struct slab *
+obj_to_slab (const void *obj) {
+	struct slab *s = pg_round_down (obj);
+
+	return s->magic == SLAB_MAGIC ? s : NULL;
+}
+
+/* Returns the cache that OBJ was allocated from, or a null pointer
+   if OBJ is not an object of a cache. */
+struct kmem_cache *
+kmem_cache_of (const void *obj) {
+	struct slab *s = obj_to_slab (obj);
+
+	return s != NULL ? s->cache : NULL;
+}
+
+/* Returns OBJ, which must have been allocated from cache C, to C. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) {
+	struct slab *s;
+	size_t idx;
+
+	if (obj == NULL)
+		return;
+	s = obj_to_slab (obj);
+	ASSERT (s != NULL && s->cache == c);
+	idx = ((uint8_t *) obj - (uint8_t *) slab_obj (s, 0)) / c->obj_size;
+	ASSERT (obj == slab_obj (s, idx));
+
+	lock_acquire (&c->lock);
+	if (s->free_cnt == 0) {
+		list_remove (&s->elem);
+		list_push_front (&c->partial, &s->elem);
+	}
+	s->free[s->free_cnt++] = idx;
+	c->active_cnt--;
+	c->free_cnt++;
+
+	/* Keep one free slab, give back the others. */
+	if (s->free_cnt == c->objs_per_slab) {
+		if (c->empty_cnt > 0) {
+			list_remove (&s->elem);
+			s->magic = 0;
+			palloc_free_page (s);
+			c->slab_cnt--;
+		} else
+			c->empty_cnt++;
+	}
+	lock_release (&c->lock);
+}
+
+/* Prints object cache statistics. */
+void
+kmem_print_stats (void) {
+	size_t i;
+
+	for (i = 0; i < cache_cnt; i++) {
+		struct kmem_cache *c = &caches[i];
+		printf ("Cache %s: %zu-byte objects, %zu in use, %zu slabs, "
+				"%lld allocs, %lld frees\n",
+				c->name, c->obj_size, c->active_cnt, c->slab_cnt,
+				c->alloc_cnt, c->free_cnt);
+	}
+}
@@ -3,6 +3,8 @@
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "intrinsic.h"
 /* --------------------[project1]-----------------------*/
 void donate_priority(void);
 void remove_with_lock(struct lock *lock);
@@ -12,28 +14,103 @@ bool sem_priority_less(const struct list_elem *a, const struct list_elem *b, voi
 bool donate_priority_less(struct list_elem *a, struct list_elem *b, void *aux);
 /* --------------------[project1]-----------------------*/
 
-void sema_init(struct semaphore *sema, unsigned value)
+/* 경합 통계.  락과 세마포어는 이름별로 묶어서 센다.  락은 해제된
+   객체 안에 들어 있기도 하므로 개별 락을 등록해 두면 댕글링 포인터가
+   되지만, 이름별 항목은 고정된 테이블에 있어서 끝까지 남는다.
+   시간은 rdtsc로 재므로 단위는 TSC tick이다. */
+struct sync_stats
+{
+	const char *name;	 /* 락 또는 세마포어 이름. */
+	bool is_lock;		 /* 락이면 true. */
+	uint64_t acquires;	 /* 획득 횟수. */
+	uint64_t contended;	 /* 그중 기다려야 했던 횟수. */
+	uint64_t wait_total; /* 기다린 시간의 합. */
+	uint64_t wait_max;	 /* 가장 오래 기다린 시간. */
+	uint64_t hold_max;	 /* 락을 가장 오래 쥐고 있던 시간. */
+};
+
+#define SYNC_STATS_MAX 64
+static struct sync_stats sync_stats[SYNC_STATS_MAX];
+static size_t sync_stats_cnt;
+static size_t sync_stats_dropped; /* 테이블이 가득 차서 세지 못한 초기화 횟수 */
+
+bool lockstat_enabled;
+
+/* NAME에 해당하는 통계 항목을 찾고, 없으면 새로 만든다.
+   테이블이 가득 찼으면 null을 반환한다. */
+static struct sync_stats *
+sync_stats_lookup(const char *name, bool is_lock)
+{
+	struct sync_stats *s = NULL;
+	enum intr_level old_level;
+	size_t i;
+
+	if (*name == '&') /* "&filesys_lock" -> "filesys_lock" */
+		name++;
+
+	old_level = intr_disable();
+	for (i = 0; i < sync_stats_cnt; i++)
+		if (sync_stats[i].is_lock == is_lock && !strcmp(sync_stats[i].name, name))
+		{
+			s = &sync_stats[i];
+			break;
+		}
+	if (s == NULL)
+	{
+		if (sync_stats_cnt < SYNC_STATS_MAX)
+		{
+			s = &sync_stats[sync_stats_cnt++];
+			s->name = name;
+			s->is_lock = is_lock;
+		}
+		else
+			sync_stats_dropped++;
+	}
+	intr_set_level(old_level);
+	return s;
+}
+
+/* SEMA를 VALUE로 초기화한다.  -lockstat이 켜져 있으면 NAME 이름으로
+   통계를 모은다.  NAME이 null이면 모으지 않는다. */
+void sema_init_named(struct semaphore *sema, unsigned value, const char *name)
 {
 	ASSERT(sema != NULL);
 
 	sema->value = value;
 	list_init(&sema->waiters);
+	sema->stats = lockstat_enabled && name != NULL ? sync_stats_lookup(name, false) : NULL;
 }
 
 void sema_down(struct semaphore *sema)
 {
 	enum intr_level old_level;
+	uint64_t wait_start = 0;
 
 	ASSERT(sema != NULL);
 	ASSERT(!intr_context());
 
 	old_level = intr_disable();
+	if (sema->stats != NULL && sema->value == 0)
+		wait_start = rdtsc();
 	while (sema->value == 0) /* sema에 접근할 수 없을 때 */
 	{
 		list_insert_ordered(&sema->waiters, &thread_current()->elem, &priority_less, NULL); /* 접근 권한이 생기기를 기다리는 스레드를 waiters에 추가 */
 		thread_block();																		   /* 해당 스레드 block */
 	}
 	sema->value--;
+	if (sema->stats != NULL)
+	{
+		struct sync_stats *s = sema->stats;
+		s->acquires++;
+		if (wait_start != 0) /* 기다렸던 경우 */
+		{
+			uint64_t wait = rdtsc() - wait_start;
+			s->contended++;
+			s->wait_total += wait;
+			if (wait > s->wait_max)
+				s->wait_max = wait;
+		}
+	}
 	intr_set_level(old_level);
 }
 
@@ -48,6 +125,8 @@ bool sema_try_down(struct semaphore *sema)
 	if (sema->value > 0)
 	{
 		sema->value--;
+		if (sema->stats != NULL)
+			sema->stats->acquires++;
 		success = true;
 	}
 	else
@@ -107,12 +186,17 @@ sema_test_helper(void *sema_)
 	}
 }
 
-void lock_init(struct lock *lock)
+/* LOCK을 초기화한다.  -lockstat이 켜져 있으면 NAME 이름으로
+   통계를 모은다.  통계는 LOCK 안의 세마포어에 달아 둔다. */
+void lock_init_named(struct lock *lock, const char *name)
 {
 	ASSERT(lock != NULL);
 
 	lock->holder = NULL;
-	sema_init(&lock->semaphore, 1);
+	sema_init_named(&lock->semaphore, 1, NULL);
+	if (lockstat_enabled && name != NULL)
+		lock->semaphore.stats = sync_stats_lookup(name, true);
+	lock->acquired_tsc = 0;
 }
 
 /* --------------------[project2]-----------------------*/
@@ -123,16 +207,22 @@ void lock_acquire(struct lock *lock)
 	ASSERT(!intr_context());
 	ASSERT(!lock_held_by_current_thread(lock));
 
-	if (lock->holder)
+	bool contended = lock->holder != NULL;
+	if (contended)
 	{
+		TRACE(TRACE_LOCK_WAIT, lock, lock->holder->tid);
 		thread_current()->wait_on_lock = lock;
 		list_insert_ordered(&lock->holder->donations, &thread_current()->donation_elem, &donate_priority_less, NULL);
 		donate_priority();
 	}
 
-	sema_down(&lock->semaphore);
+	sema_down(&lock->semaphore); /* 대기 시간은 sema_down()이 잰다. */
 	lock->holder = thread_current();
+	if (lock->semaphore.stats != NULL)
+		lock->acquired_tsc = rdtsc();
 	thread_current()->wait_on_lock = NULL;
+	if (contended)
+		TRACE(TRACE_LOCK_ACQUIRED, lock, 0);
 }
 /* --------------------[project2]-----------------------*/
 
@@ -145,7 +235,11 @@ bool lock_try_acquire(struct lock *lock)
 
 	success = sema_try_down(&lock->semaphore);
 	if (success)
+	{
 		lock->holder = thread_current();
+		if (lock->semaphore.stats != NULL)
+			lock->acquired_tsc = rdtsc();
+	}
 	return success;
 }
 
@@ -155,6 +249,16 @@ void lock_release(struct lock *lock)
 	ASSERT(lock != NULL);
 	ASSERT(lock_held_by_current_thread(lock));
 
+	if (lock->semaphore.stats != NULL)
+	{
+		struct sync_stats *s = lock->semaphore.stats;
+		uint64_t hold = rdtsc() - lock->acquired_tsc;
+		enum intr_level old_level = intr_disable();
+		if (hold > s->hold_max)
+			s->hold_max = hold;
+		intr_set_level(old_level);
+	}
+
 	remove_with_lock(lock);
 	refresh_priority();
 	lock->holder = NULL; /* lock의 holder 초기화 */
@@ -170,6 +274,46 @@ bool lock_held_by_current_thread(const struct lock *lock)
 	return lock->holder == thread_current();
 }
 
+/* -lockstat 통계를 기다린 시간의 합이 큰 순서로 출력한다. */
+void synch_print_stats(void)
+{
+	struct sync_stats *order[SYNC_STATS_MAX];
+	size_t cnt = 0;
+	size_t i, j;
+
+	if (!lockstat_enabled)
+		return;
+
+	for (i = 0; i < sync_stats_cnt; i++)
+	{
+		struct sync_stats *s = &sync_stats[i];
+		if (s->acquires == 0)
+			continue;
+		for (j = cnt++; j > 0 && order[j - 1]->wait_total < s->wait_total; j--)
+			order[j] = order[j - 1];
+		order[j] = s;
+	}
+
+	printf("Lock statistics (times in TSC ticks):\n");
+	printf("%-20s %4s %10s %10s %14s %12s %12s\n",
+		   "name", "type", "acquires", "contended", "wait total", "wait max", "hold max");
+	for (i = 0; i < cnt; i++)
+	{
+		struct sync_stats *s = order[i];
+		printf("%-20.20s %4s %10llu %10llu %14llu %12llu ",
+			   s->name, s->is_lock ? "lock" : "sema",
+			   (unsigned long long)s->acquires, (unsigned long long)s->contended,
+			   (unsigned long long)s->wait_total, (unsigned long long)s->wait_max);
+		if (s->is_lock)
+			printf("%12llu\n", (unsigned long long)s->hold_max);
+		else
+			printf("%12s\n", "-");
+	}
+	if (sync_stats_dropped > 0)
+		printf("%zu lock or semaphore initializations not counted, table full\n",
+			   sync_stats_dropped);
+}
+
 /* --------------------[project1]-----------------------*/
 /* 현재 스레드가 lock을 기다리고 있는 경우, lock을 보유하고 있는 다른 스레드의 우선순위를 현재 스레드의 우선순위로 업데이트(donation)하는 함수 */
 void donate_priority(void)
@@ -244,7 +388,7 @@ void cond_wait(struct condition *cond, struct lock *lock)
 	ASSERT(!intr_context());
 	ASSERT(lock_held_by_current_thread(lock));
 
-	sema_init(&waiter.semaphore, 0);
+	sema_init_named(&waiter.semaphore, 0, NULL); /* 조건 대기는 경합이 아니다. */
 	waiter.semaphore.priority = thread_current()->priority;
 
 	list_insert_ordered(&cond->waiters, &waiter.elem, &sem_priority_less, NULL);
@@ -7,3 +7,6 @@ threads_SRC += threads/palloc.c		# Page allocator.
 threads_SRC += threads/malloc.c		# Subpage allocator.
 threads_SRC += threads/start.S		# Startup code.
 threads_SRC += threads/mmu.c		    # Memory management unit related things.
+threads_SRC += threads/slab.c		# Object caches.
+threads_SRC += threads/trace.c		# Event tracing.
+threads_SRC += threads/prof.c		# Sampling profiler.
@@ -8,8 +8,10 @@
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 #include "intrinsic.h"
 #ifdef USERPROG
@@ -30,6 +32,12 @@ static struct lock tid_lock;
 
 static struct list destruction_req;
 
+/* 죽은 스레드의 페이지를 모아 두었다가 thread_create()에서 다시 쓰는 풀.
+   palloc에서 새 페이지를 받아 0으로 채우는 비용을 줄인다. */
+#define THREAD_POOL_MAX 8
+static struct list thread_pool;
+static size_t thread_pool_cnt;
+
 static long long idle_ticks;
 static long long kernel_ticks;
 static long long user_ticks;
@@ -47,14 +55,21 @@ static void init_thread(struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule(void);
 static tid_t allocate_tid(void);
+static struct thread *thread_pool_get(void);
+static void thread_pool_put(struct thread *t);
 void update_next_to_wake(int64_t local_ticks);
 
 /*----------------[project1]-------------------*/
-static struct list sleep_list;
+static struct rbtree sleep_tree; /* 깰 시간 순으로 정렬된 잠든 스레드 */
 static int64_t min_ticks; 
 
 void thread_wakeup(int64_t ticks);
 void thread_sleep(int64_t ticks);
+static bool wake_less(const struct rb_node *a, const struct rb_node *b,
+					  void *aux UNUSED);
+static bool add_child(struct thread *parent, struct thread *child);
+static tid_t create_thread(const char *name, int priority,
+						   thread_func *function, void *aux, bool child);
 int64_t get_next_to_wakeup(void);
 void test_max_priority(void);
 bool priority_less(const struct list_elem *a_, const struct list_elem *b_,
@@ -78,8 +93,9 @@ void thread_init(void)
 
 	lock_init(&tid_lock);
 	list_init(&ready_list);
-	list_init(&sleep_list);
+	rb_init(&sleep_tree);
 	list_init(&destruction_req);
+	list_init(&thread_pool);
 
 	min_ticks = INT64_MAX; /**/
 
@@ -101,10 +117,16 @@ void thread_start(void)
 	sema_down(&idle_started);
 }
 
-void thread_tick(void)
+void thread_tick(bool user)
 {
 	struct thread *t = thread_current();
 
+	/* USER는 타이머가 유저 모드를 끊고 들어왔는지 여부 */
+	if (user)
+		t->rusage.user_ticks++;
+	else
+		t->rusage.kernel_ticks++;
+
 	if (t == idle_thread)
 		idle_ticks++;
 #ifdef USERPROG
@@ -126,6 +148,22 @@ void thread_print_stats(void)
 
 tid_t thread_create(const char *name, int priority,
 					thread_func *function, void *aux)
+{
+	return create_thread(name, priority, function, aux, false);
+}
+
+/* thread_create()와 같지만, 호출한 스레드가 process_wait()으로 기다릴 수
+   있도록 종료 상태 레코드를 붙인다. 레코드는 process_exit()이 놓으므로
+   프로세스가 될 스레드만 이 함수로 만든다. */
+tid_t thread_create_child(const char *name, int priority,
+						  thread_func *function, void *aux)
+{
+	return create_thread(name, priority, function, aux, true);
+}
+
+/* 새 스레드를 만든다. CHILD이면 종료 상태 레코드를 붙인다. */
+static tid_t create_thread(const char *name, int priority,
+						   thread_func *function, void *aux, bool child)
 {
 	struct thread *t;
 	tid_t tid;
@@ -133,26 +171,29 @@ tid_t thread_create(const char *name, int priority,
 	ASSERT(function != NULL);
 
 	/*----------------[project2]-------------------*/
-	t = palloc_get_page(PAL_ZERO);
+	t = thread_pool_get();
 	if (t == NULL)
 		return TID_ERROR;
 
 	init_thread(t, name, priority);
 	tid = t->tid = allocate_tid();
 
-	struct thread *curr = thread_current();
-	list_push_back(&curr->children_list, &t->child_elem);
-
-	t->fdt = palloc_get_multiple(PAL_ZERO, FDT_PAGES);
-	if (t->fdt == NULL)
+	/* 대부분의 프로세스는 파일을 몇 개만 열기 때문에 fdt는 작게 시작한다. */
+	t->fd_cap = FDT_INIT_CNT;
+	t->fdt = calloc(FDT_INIT_CNT, sizeof *t->fdt);
+	t->fd_map = calloc(FD_MAP_WORDS(FDT_INIT_CNT), sizeof *t->fd_map);
+	if (t->fdt == NULL || t->fd_map == NULL
+		|| (child && !add_child(thread_current(), t)))
+	{
+		free(t->fdt);
+		free(t->fd_map);
+		thread_pool_put(t);
 		return TID_ERROR;
+	}
 
-	t->next_fd = 2;
 	t->fdt[0] = 1; 
 	t->fdt[1] = 2; 
-
-	t->stdin_count = 1;
-	t->stdout_count = 1;
+	t->fd_map[0] = 0x3;
 	/*----------------[project2]-------------------*/
 
 	t->tf.rip = (uintptr_t)kernel_thread;
@@ -300,6 +341,11 @@ idle(void *idle_started_ UNUSED)
 
 	for (;;)
 	{
+		/* 할 일이 없는 동안 PAL_ZERO 요청에 쓸 페이지를 미리 0으로 채워 둔다.
+		   준비된 스레드가 생기면 한 페이지 안에 멈추고 바로 양보한다. */
+		while (list_empty(&ready_list) && palloc_zero_idle())
+			continue;
+
 		intr_disable();
 		thread_block();
 
@@ -340,11 +386,8 @@ init_thread(struct thread *t, const char *name, int priority)
 	/*----------------[project1]-------------------*/
 
 	/*----------------[project2]-------------------*/
-	list_init(&t->children_list);
-
-	sema_init(&t->wait_sema, 0);
-	sema_init(&t->fork_sema, 0);
-	sema_init(&t->free_sema, 0);
+	t->has_children = false;
+	t->exit_rec = NULL;
 	t->running = NULL;
 	t->exit_status = 0;
 	/*----------------[project2]-------------------*/
@@ -451,7 +494,7 @@ static void do_schedule(int status)
 	{
 		struct thread *victim =
 			list_entry(list_pop_front(&destruction_req), struct thread, elem);
-		palloc_free_page(victim);
+		thread_pool_put(victim);
 	}
 	thread_current()->status = status;
 	schedule();
@@ -484,6 +527,8 @@ static void schedule(void)
 			list_push_back(&destruction_req, &curr->elem);
 		}
 
+		curr->rusage.context_switches++;
+		TRACE(TRACE_SWITCH, next->tid, 0);
 		thread_launch(next);
 	}
 }
@@ -501,6 +546,43 @@ allocate_tid(void)
 	return tid;
 }
 
+/* 스레드 페이지를 하나 꺼내는 함수. 풀이 비어 있을 때만 palloc에서 받는다.
+   init_thread()가 struct thread를 다시 0으로 채우므로, 재사용하는 페이지의
+   나머지(커널 스택)는 지울 필요가 없다. */
+static struct thread *thread_pool_get(void)
+{
+	struct thread *t = NULL;
+	enum intr_level old_level = intr_disable();
+
+	if (!list_empty(&thread_pool))
+	{
+		t = list_entry(list_pop_front(&thread_pool), struct thread, elem);
+		thread_pool_cnt--;
+	}
+	intr_set_level(old_level);
+
+	return t != NULL ? t : palloc_get_page(PAL_ZERO);
+}
+
+/* 다 쓴 스레드 페이지 T를 풀에 돌려주는 함수. 풀이 가득 찼으면 해제한다.
+   do_schedule()에서 인터럽트가 꺼진 채로 불린다. */
+static void thread_pool_put(struct thread *t)
+{
+	enum intr_level old_level = intr_disable();
+
+	if (thread_pool_cnt < THREAD_POOL_MAX)
+	{
+		t->magic = 0;
+		list_push_front(&thread_pool, &t->elem);
+		thread_pool_cnt++;
+		t = NULL;
+	}
+	intr_set_level(old_level);
+
+	if (t != NULL)
+		palloc_free_page(t);
+}
+
 /*-------------------------[project 1]-------------------------*/
 void thread_sleep(int64_t local_ticks) /* local_ticks: 깨울 시간 */
 {
@@ -513,8 +595,8 @@ void thread_sleep(int64_t local_ticks) /* local_ticks: 깨울 시간 */
 	old_level = intr_disable(); /* 인터럽트 방지 */
 
 	curr->wake_up_tick = local_ticks;
-	update_next_to_wake(local_ticks); /* sleep_list의 min_tick 업데이트 */
-	list_push_back(&sleep_list, &curr->elem);
+	update_next_to_wake(local_ticks); /* sleep_tree의 min_tick 업데이트 */
+	rb_insert(&sleep_tree, &curr->sleep_elem, wake_less, NULL);
 	thread_block();
 
 	intr_set_level(old_level); /* 인터럽트 재개 */
@@ -522,27 +604,122 @@ void thread_sleep(int64_t local_ticks) /* local_ticks: 깨울 시간 */
 
 void thread_wakeup(int64_t ticks) /* ticks: global ticks */
 {
-	struct list_elem *curr = list_begin(&sleep_list);
-	/* ⚠️ list_front 사용 시 sleep_list가 비어 있을 경우, ASSERT 발생 => list_begin 사용 */
-	while (curr != list_end(&sleep_list)) /* sleep_list 끝까지 탐색 */
+	struct rb_node *first;
+
+	/* 가장 먼저 깰 스레드부터 보므로, 깰 시간이 안 된 스레드를 만나면 멈춘다. */
+	while ((first = rb_first(&sleep_tree)) != NULL)
 	{
-		struct thread *t = list_entry(curr, struct thread, elem);
-		int64_t tmp_ticks = t->wake_up_tick;
-		if (tmp_ticks <= ticks) /* 현재 탐색 중인 스레드가 깰 시간이 되었을 때 */
-		{
-			curr = list_remove(&t->elem); /* sleep_list에서 제거 */
-			thread_unblock(t);
-			/*
-			⚠️ thread_unblock을 list_remove보다 먼저 사용 시 ready_list로 이동 => list_remove 시 ready_list에서 제거
-				* 원래 의도: sleep_list에서 제거
-			 */
-		}
-		else /* 깨울 스레드가 아니면 */
-		{
-			curr = list_next(curr);
-			update_next_to_wake(t->wake_up_tick);
-		}
+		struct thread *t = rb_entry(first, struct thread, sleep_elem);
+		if (t->wake_up_tick > ticks)
+			break;
+		rb_remove(&sleep_tree, first);
+		thread_unblock(t);
+	}
+
+	/* 남은 스레드 중 가장 이른 깰 시간이 다음 min_ticks가 된다. */
+	min_ticks = first != NULL
+					? rb_entry(first, struct thread, sleep_elem)->wake_up_tick
+					: INT64_MAX;
+}
+
+/* 깰 시간이 이른 스레드가 앞에 오도록 비교하는 함수 */
+static bool wake_less(const struct rb_node *a, const struct rb_node *b,
+					  void *aux UNUSED)
+{
+	return rb_entry(a, struct thread, sleep_elem)->wake_up_tick
+		   < rb_entry(b, struct thread, sleep_elem)->wake_up_tick;
+}
+
+/*-------------------------[project 2]-------------------------*/
+/* exit_record를 tid로 해싱하는 함수 */
+static uint64_t child_hash(const struct hash_elem *e, void *aux UNUSED)
+{
+	return hash_int(hash_entry(e, struct exit_record, elem)->tid);
+}
+
+static bool child_less(const struct hash_elem *a, const struct hash_elem *b,
+					   void *aux UNUSED)
+{
+	return hash_entry(a, struct exit_record, elem)->tid
+		   < hash_entry(b, struct exit_record, elem)->tid;
+}
+
+/* CHILD의 종료 상태 레코드를 만들어 PARENT의 children 해시에 넣는 함수.
+   레코드는 부모와 자식이 하나씩 참조한다. */
+static bool add_child(struct thread *parent, struct thread *child)
+{
+	struct exit_record *rec;
+
+	/* 첫 자식을 만들 때 해시를 초기화한다. main 스레드는 malloc보다 먼저 만들어진다. */
+	if (!parent->has_children)
+	{
+		if (!hash_init(&parent->children, child_hash, child_less, NULL))
+			return false;
+		parent->has_children = true;
 	}
+
+	rec = malloc(sizeof *rec);
+	if (rec == NULL)
+		return false;
+	rec->tid = child->tid;
+	rec->exit_status = 0;
+	rec->fork_failed = false;
+	rec->ref_cnt = 2;
+	sema_init(&rec->fork_sema, 0);
+	sema_init(&rec->wait_sema, 0);
+	hash_insert(&parent->children, &rec->elem);
+	child->exit_rec = rec;
+	return true;
+}
+
+/* 현재 스레드의 자식 중 tid가 TID인 자식의 레코드를 반환하는 함수. 없으면 NULL */
+struct exit_record *thread_get_child(tid_t tid)
+{
+	struct thread *curr = thread_current();
+	struct exit_record key;
+	struct hash_elem *e;
+
+	if (!curr->has_children)
+		return NULL;
+	key.tid = tid;
+	e = hash_find(&curr->children, &key.elem);
+	return e != NULL ? hash_entry(e, struct exit_record, elem) : NULL;
+}
+
+/* 다 기다린 자식의 레코드 REC를 children 해시에서 빼고 부모의 참조를 놓는 함수 */
+void thread_forget_child(struct exit_record *rec)
+{
+	hash_delete(&thread_current()->children, &rec->elem);
+	thread_release_record(rec);
+}
+
+/* REC의 참조 하나를 놓고, 마지막 참조였으면 해제하는 함수.
+   부모와 자식이 동시에 종료할 수 있으므로 인터럽트를 끄고 센다. */
+void thread_release_record(struct exit_record *rec)
+{
+	enum intr_level old_level = intr_disable();
+	bool last = --rec->ref_cnt == 0;
+	intr_set_level(old_level);
+
+	if (last)
+		free(rec);
+}
+
+static void release_child(struct hash_elem *e, void *aux UNUSED)
+{
+	thread_release_record(hash_entry(e, struct exit_record, elem));
+}
+
+/* 종료하는 현재 스레드가 자식들의 레코드에 가진 참조를 모두 놓는 함수.
+   아직 살아 있는 자식은 종료할 때 자기 레코드를 해제한다. */
+void thread_release_children(void)
+{
+	struct thread *curr = thread_current();
+
+	if (!curr->has_children)
+		return;
+	hash_destroy(&curr->children, release_child);
+	curr->has_children = false;
 }
 
 /* local_ticks와 min_ticks 비교 => 최솟값 업데이트 */
@@ -0,0 +1,232 @@
+#include "threads/trace.h"
+#include <console.h>
+#include <debug.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+#ifdef FILESYS
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#endif
+
+/* Event tracing.
+
+   Events go into one ring buffer, which is the per-CPU buffer of
+   our only CPU.  Each event is recorded with interrupts off, so
+   that interrupt handlers can record events too.  When the ring
+   is full, new events overwrite the oldest ones.
+
+   Timestamps are read with rdtsc.  The dump converts them to
+   microseconds using the TSC rate measured against the timer
+   between trace_init() and trace_dump(). */
+
+/* Size of the ring buffer in pages. */
+#define TRACE_PAGES 64
+
+/* A recorded event. */
+struct trace_entry {
+	uint64_t tsc;               /* Time stamp counter. */
+	uint32_t event;             /* enum trace_event. */
+	int32_t tid;                /* Running thread. */
+	uint64_t a, b;              /* Arguments. */
+};
+
+bool trace_requested;
+const char *trace_file;
+bool trace_enabled;
+
+static struct trace_entry *entries;
+static size_t entry_cap;        /* Number of entries, a power of 2. */
+static uint64_t record_cnt;     /* Events recorded, including overwritten. */
+
+/* When tracing started. */
+static uint64_t start_tsc;
+static int64_t start_ticks;
+
+/* Where the dump goes. */
+struct trace_sink {
+	bool count_only;            /* Only count the bytes? */
+	size_t size;                /* Bytes written or counted. */
+#ifdef FILESYS
+	struct file *file;          /* File, or null for the console. */
+#endif
+};
+
+static void dump_to (struct trace_sink *);
+
+/* Starts tracing if it was requested on the command line.  Must
+   be called after the page allocator is initialized. */
+void
+trace_init (void) {
+	size_t cap;
+
+	if (!trace_requested)
+		return;
+
+	entries = palloc_get_multiple (0, TRACE_PAGES);
+	if (entries == NULL) {
+		printf ("trace: out of memory, tracing disabled\n");
+		return;
+	}
+	for (cap = 1; cap * 2 <= TRACE_PAGES * PGSIZE / sizeof *entries; cap *= 2)
+		continue;
+	entry_cap = cap;
+	start_tsc = rdtsc ();
+	start_ticks = timer_ticks ();
+	trace_enabled = true;
+}
+
+/* Records EVENT with arguments A and B.  Use TRACE() instead,
+   which does nothing when tracing is off. */
+void
+trace_record (enum trace_event event, uint64_t a, uint64_t b) {
+	enum intr_level old_level = intr_disable ();
+	struct trace_entry *e = &entries[record_cnt++ & (entry_cap - 1)];
+
+	e->tsc = rdtsc ();
+	e->event = event;
+	/* Not thread_current(), which insists that the thread is
+	   running, while context switches are traced halfway. */
+	e->tid = ((struct thread *) pg_round_down (rrsp ()))->tid;
+	e->a = a;
+	e->b = b;
+	intr_set_level (old_level);
+}
+
+/* Stops tracing and writes out the recorded events, to the
+   console or to the file named with -trace. */
+void
+trace_dump (void) {
+	struct trace_sink sink = {0};
+
+	if (!trace_enabled)
+		return;
+	trace_enabled = false;
+
+#ifdef FILESYS
+	if (trace_file != NULL) {
+		/* Files cannot grow, so measure the output first. */
+		sink.count_only = true;
+		dump_to (&sink);
+		if (!filesys_create (trace_file, sink.size)
+				|| (sink.file = filesys_open (trace_file)) == NULL) {
+			printf ("trace: cannot create \"%s\"\n", trace_file);
+			return;
+		}
+		sink.count_only = false;
+		sink.size = 0;
+		dump_to (&sink);
+		file_close (sink.file);
+		printf ("trace: wrote %zu bytes to \"%s\"\n", sink.size, trace_file);
+		return;
+	}
+#endif
+	printf ("trace: begin\n");
+	dump_to (&sink);
+	printf ("trace: end\n");
+}
+
+/* Formats like printf() into SINK. */
+static void PRINTF_FORMAT (2, 3)
+emit (struct trace_sink *sink, const char *format, ...) {
+	char buf[256];
+	va_list args;
+	int len;
+
+	va_start (args, format);
+	len = vsnprintf (buf, sizeof buf, format, args);
+	va_end (args);
+	if (len >= (int) sizeof buf)
+		len = sizeof buf - 1;
+
+	if (!sink->count_only) {
+#ifdef FILESYS
+		if (sink->file != NULL)
+			file_write (sink->file, buf, len);
+		else
+#endif
+			putbuf (buf, len);
+	}
+	sink->size += len;
+}
+
+/* Event names, and the Chrome trace phase of each event. */
+static const struct {
+	const char *name;
+	char phase;
+} event_info[TRACE_EVENT_CNT] = {
+	[TRACE_SWITCH] = {"switch", 'i'},
+	[TRACE_PAGE_FAULT] = {"page fault", 'i'},
+	[TRACE_SYSCALL_ENTER] = {"syscall", 'B'},
+	[TRACE_SYSCALL_EXIT] = {"syscall", 'E'},
+	[TRACE_DISK_SUBMIT] = {"disk", 'b'},
+	[TRACE_DISK_COMPLETE] = {"disk", 'e'},
+	[TRACE_LOCK_WAIT] = {"lock wait", 'B'},
+	[TRACE_LOCK_ACQUIRED] = {"lock wait", 'E'},
+};
+
+/* Writes the recorded events to SINK as a Chrome trace, one
+   event per line. */
+static void
+dump_to (struct trace_sink *sink) {
+	uint64_t first = record_cnt > entry_cap ? record_cnt - entry_cap : 0;
+	uint64_t ms = (uint64_t) timer_elapsed (start_ticks) * 1000 / TIMER_FREQ;
+	uint64_t tsc_per_ms = ms > 0 ? (rdtsc () - start_tsc) / ms : 0;
+	uint64_t i;
+
+	if (tsc_per_ms == 0)
+		tsc_per_ms = 1;
+
+	emit (sink, "{\"otherData\":{\"dropped\":%llu},\"traceEvents\":[\n",
+			(unsigned long long) first);
+	for (i = first; i < record_cnt; i++) {
+		const struct trace_entry *e = &entries[i & (entry_cap - 1)];
+		uint64_t delta = e->tsc - start_tsc;
+		uint64_t ns = delta / tsc_per_ms * 1000000
+			+ delta % tsc_per_ms * 1000000 / tsc_per_ms;
+
+		emit (sink, "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu.%03llu,"
+				"\"pid\":0,\"tid\":%d",
+				event_info[e->event].name, event_info[e->event].phase,
+				(unsigned long long) (ns / 1000),
+				(unsigned long long) (ns % 1000), e->tid);
+		switch (e->event) {
+			case TRACE_SWITCH:
+				emit (sink, ",\"s\":\"t\",\"args\":{\"next\":%d}",
+						(int) e->a);
+				break;
+			case TRACE_PAGE_FAULT:
+				emit (sink, ",\"s\":\"t\",\"args\":{\"addr\":\"%#llx\","
+						"\"rip\":\"%#llx\"}",
+						(unsigned long long) e->a, (unsigned long long) e->b);
+				break;
+			case TRACE_SYSCALL_ENTER:
+				emit (sink, ",\"args\":{\"nr\":%llu}",
+						(unsigned long long) e->a);
+				break;
+			case TRACE_SYSCALL_EXIT:
+				emit (sink, ",\"args\":{\"ret\":%lld}", (long long) e->b);
+				break;
+			case TRACE_DISK_SUBMIT:
+			case TRACE_DISK_COMPLETE:
+				emit (sink, ",\"cat\":\"disk\",\"id\":%llu,"
+						"\"args\":{\"sector\":%llu,\"write\":%s}",
+						(unsigned long long) e->a, (unsigned long long) e->a,
+						e->b ? "true" : "false");
+				break;
+			case TRACE_LOCK_WAIT:
+				emit (sink, ",\"args\":{\"lock\":\"%#llx\",\"holder\":%d}",
+						(unsigned long long) e->a, (int) e->b);
+				break;
+			default:
+				break;
+		}
+		emit (sink, "}%s\n", i + 1 < record_cnt ? "," : "");
+	}
+	emit (sink, "]}\n");
+}
@@ -4,6 +4,8 @@
 #include "userprog/gdt.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "threads/vaddr.h"
 #include "intrinsic.h"
 
 /* Number of page faults processed. */
@@ -11,6 +13,7 @@ static long long page_fault_cnt;
 
 static void kill(struct intr_frame *);
 static void page_fault(struct intr_frame *);
+static bool search_fixup(struct intr_frame *);
 
 /* Registers handlers for interrupts that can be caused by user
    programs.
@@ -136,6 +139,8 @@ page_fault(struct intr_frame *f)
 	/* Turn interrupts back on (they were only off so that we could
 	   be assured of reading CR2 before it changed). */
 	intr_enable();
+	TRACE(TRACE_PAGE_FAULT, fault_addr, f->rip);
+	thread_current()->rusage.page_faults++;
 
 	/* Determine cause. */
 	not_present = (f->error_code & PF_P) == 0;
@@ -155,6 +160,12 @@ page_fault(struct intr_frame *f)
 	/* Count page faults. */
 	page_fault_cnt++;
 
+	/* A bad user pointer handed to one of the user-copy routines
+	   below: resume at the routine's recovery code, which reports
+	   the failure to its caller. */
+	if (!user && search_fixup(f))
+		return;
+
 	/* If the fault is true fault, show info and exit. */
 	printf("Page fault at %p: %s error %s page in %s context.\n",
 		   fault_addr,
@@ -164,3 +175,153 @@ page_fault(struct intr_frame *f)
 	// kill (f);
 	exit(-1); /* 🤔 */
 }
+
+/* User memory access.
+
+   The kernel never walks the page table to decide whether a user
+   pointer is good.  It simply dereferences the pointer from one of
+   the routines below, and if that faults (and the VM cannot bring
+   the page in), page_fault() finds the faulting instruction in
+   the fixup table and resumes at its recovery code instead of
+   killing the process.  Since the pointer is only checked against
+   KERN_BASE up front, the cost of validation is the access itself.
+
+   Kernel writes to read-only user pages fault too, because start.S
+   turns on CR0.WP. */
+
+/* Copies RDX bytes from RSI to RDI.  Returns the number of bytes
+   left uncopied in RAX, which is 0 on success. */
+uint64_t user_copy(void *dst, const void *src, size_t size);
+
+/* Copies the string at RSI to RDI, at most RDX bytes including
+   the null terminator.  Returns the length of the string in RAX,
+   RDX if no null terminator was found within RDX bytes, or -1 on
+   a fault. */
+int64_t user_strncpy(char *dst, const char *src, size_t size);
+
+asm(".text\n"
+	".globl user_copy\n"
+	"user_copy:\n"
+	"	movq %rdx, %rcx\n"
+	"user_copy_insn:\n"
+	"	rep movsb\n"
+	"	xorl %eax, %eax\n"
+	"	ret\n"
+	"user_copy_fixup:\n"
+	"	movq %rcx, %rax\n"
+	"	ret\n"
+
+	".globl user_strncpy\n"
+	"user_strncpy:\n"
+	"	xorl %eax, %eax\n"
+	"1:	cmpq %rdx, %rax\n"
+	"	je 2f\n"
+	"user_strncpy_insn:\n"
+	"	movb (%rsi,%rax), %cl\n"
+	"	movb %cl, (%rdi,%rax)\n"
+	"	testb %cl, %cl\n"
+	"	jz 2f\n"
+	"	incq %rax\n"
+	"	jmp 1b\n"
+	"2:	ret\n"
+	"user_strncpy_fixup:\n"
+	"	movq $-1, %rax\n"
+	"	ret\n");
+
+extern const char user_copy_insn[], user_copy_fixup[];
+extern const char user_strncpy_insn[], user_strncpy_fixup[];
+
+/* Instructions that may fault on a user address, and where to
+   resume when they do. */
+static const struct fixup
+{
+	const char *insn;
+	const char *fixup;
+} fixups[] = {
+	{user_copy_insn, user_copy_fixup},
+	{user_strncpy_insn, user_strncpy_fixup},
+};
+
+/* If F faulted at one of the instructions in FIXUPS, points F at
+   the matching recovery code and returns true. */
+static bool
+search_fixup(struct intr_frame *f)
+{
+	size_t i;
+
+	for (i = 0; i < sizeof fixups / sizeof *fixups; i++)
+		if (f->rip == (uintptr_t)fixups[i].insn)
+		{
+			f->rip = (uintptr_t)fixups[i].fixup;
+			return true;
+		}
+	return false;
+}
+
+/* Returns true if [UADDR, UADDR + SIZE) lies in user space. */
+static bool
+user_range_ok(const void *uaddr, size_t size)
+{
+	uintptr_t start = (uintptr_t)uaddr;
+
+	return start + size >= start && start + size <= KERN_BASE;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel buffer DST.
+   Returns true if successful, false if any of the user bytes
+   could not be read. */
+bool copy_from_user(void *dst, const void *usrc, size_t size)
+{
+	return user_range_ok(usrc, size) && user_copy(dst, usrc, size) == 0;
+}
+
+/* Copies SIZE bytes from kernel buffer SRC to user address UDST.
+   Returns true if successful, false if any of the user bytes
+   could not be written. */
+bool copy_to_user(void *udst, const void *src, size_t size)
+{
+	return user_range_ok(udst, size) && user_copy(udst, src, size) == 0;
+}
+
+/* Copies the null-terminated string at user address USRC into
+   DST, which has room for SIZE bytes.  Returns the length of the
+   string, SIZE if it does not fit (DST is then not terminated),
+   or -1 if the string could not be read. */
+int strncpy_from_user(char *dst, const char *usrc, size_t size)
+{
+	uintptr_t start = (uintptr_t)usrc;
+	size_t max;
+
+	if (start >= KERN_BASE)
+		return -1;
+	max = KERN_BASE - start < size ? KERN_BASE - start : size;
+	int64_t len = user_strncpy(dst, usrc, max);
+	if (len == (int64_t)max && max < size)
+		return -1;
+	return len;
+}
+
+/* Returns true if every page of [UADDR, UADDR + SIZE) can be read
+   by the kernel, and also written if WRITE is true, bringing the
+   pages in as needed.  Each page is touched once. */
+bool probe_user(void *uaddr, size_t size, bool write)
+{
+	uint8_t *p, *end;
+	uint8_t byte;
+
+	if (!user_range_ok(uaddr, size))
+		return false;
+	if (size == 0)
+		return true;
+
+	end = (uint8_t *)uaddr + size - 1;
+	for (p = uaddr;; p = pg_round_down(p) + PGSIZE)
+	{
+		if (user_copy(&byte, p, 1) != 0)
+			return false;
+		if (write && user_copy(p, &byte, 1) != 0)
+			return false;
+		if (pg_round_down(p) == pg_round_down(end))
+			return true;
+	}
+}
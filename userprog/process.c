@@ -10,6 +10,7 @@
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
@@ -18,18 +19,24 @@
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
 #include "intrinsic.h"
+#include "userprog/syscall.h"
+#include "threads/malloc.h"
 #ifdef VM
 #include "vm/vm.h"
 #endif
 
+/* -hp: Map large zero-filled user segments with 2 MB pages? */
+bool user_huge_pages;
+
 static void process_cleanup(void);
 static bool load(const char *file_name, struct intr_frame *if_);
 static void initd(void *f_name);
 static void __do_fork(void *);
+static void __do_spawn(void *);
+static void rusage_add(struct rusage *dst, const struct rusage *src);
 
 /*-------------------------[project 2]-------------------------*/
 void argument_stack(char **parse, int count, struct intr_frame *_if);
-struct thread *get_child_process(int pid);
 /*-------------------------[project 2]-------------------------*/
 
 /* General process initializer for initd and other process. */
@@ -62,7 +69,7 @@ tid_t process_create_initd(const char *file_name)
     /* Create a new thread to execute FILE_NAME. */
     strtok_r(file_name, " ", &save_ptr);
 
-    tid = thread_create(file_name, PRI_DEFAULT, initd, fn_copy);
+    tid = thread_create_child(file_name, PRI_DEFAULT, initd, fn_copy);
     if (tid == TID_ERROR)
         palloc_free_page(fn_copy);
     return tid;
@@ -89,7 +96,7 @@ tid_t process_fork(const char *name, struct intr_frame *if_ UNUSED)
     struct thread *curr = thread_current();
     memcpy(&curr->parent_if, if_, sizeof(struct intr_frame));
 
-    tid_t tid = thread_create(name, PRI_DEFAULT, __do_fork, curr);
+    tid_t tid = thread_create_child(name, PRI_DEFAULT, __do_fork, curr);
     /*return thread_create (name, PRI_DEFAULT, __do_fork, thread_current ());*/
 
     if (tid == TID_ERROR)
@@ -97,12 +104,17 @@ tid_t process_fork(const char *name, struct intr_frame *if_ UNUSED)
         return TID_ERROR;
     }
 
-    struct thread *child = get_child_process(tid);
+    struct exit_record *child = thread_get_child(tid);
 
     sema_down(&child->fork_sema);
 
-    if (child->exit_status == -1)
+    /* 복제에 실패한 자식은 곧 종료하므로, 기다려서 레코드를 바로 거둔다. */
+    if (child->fork_failed)
+    {
+        sema_down(&child->wait_sema);
+        thread_forget_child(child);
         return TID_ERROR;
+    }
 
     return tid;
 }
@@ -130,6 +142,35 @@ static bool duplicate_pte(uint64_t *pte, void *va, void *aux)
         return false;
     }
 
+    /* A huge page stays huge if we can get one, otherwise it is
+     * copied into ordinary pages. */
+    if (is_huge_pte(pte))
+    {
+        writable = is_writable(pte);
+        newpage = palloc_get_huge_page(PAL_USER);
+        if (newpage != NULL)
+        {
+            memcpy(newpage, parent_page, HUGE_PGSIZE);
+            if (pml4_set_huge_page(current->pml4, va, newpage, writable))
+                return true;
+            palloc_free_huge_page(newpage);
+            return false;
+        }
+        for (size_t i = 0; i < HUGE_PGCNT; i++)
+        {
+            newpage = palloc_get_page(PAL_USER);
+            if (newpage == NULL)
+                return false;
+            memcpy(newpage, (uint8_t *)parent_page + i * PGSIZE, PGSIZE);
+            if (!pml4_set_page(current->pml4, (uint8_t *)va + i * PGSIZE, newpage, writable))
+            {
+                palloc_free_page(newpage);
+                return false;
+            }
+        }
+        return true;
+    }
+
     newpage = palloc_get_page(PAL_USER | PAL_ZERO);
     if (newpage == NULL)
     {
@@ -150,6 +191,67 @@ static bool duplicate_pte(uint64_t *pte, void *va, void *aux)
 }
 #endif
 
+/*-------------------------[project 2]-------------------------*/
+/* 자식의 fd I에 들어갈 부모의 파일을 반환하는 함수. SRC가 NULL이면 같은 번호의 fd다. */
+static struct file *source_file(struct thread *parent, const int *src, int i)
+{
+    int fd = src != NULL ? src[i] : i;
+
+    if (fd < 0 || fd >= parent->fd_cap)
+        return NULL;
+    return parent->fdt[fd];
+}
+
+/* 자식의 fd 중 I 이상인 가장 작은 후보를 반환하는 함수. 없으면 -1.
+   SRC가 NULL이면 부모의 비트맵을 따라 사용 중인 fd만 돈다. */
+static int next_fd(struct thread *parent, const int *src, int cnt, int i)
+{
+    if (src == NULL)
+        return process_next_fd(parent, i);
+    return i < cnt ? i : -1;
+}
+
+/* PARENT의 fd를 현재 스레드의 fdt로 복제하는 함수.
+ * SRC가 NULL이면 모든 fd를 같은 번호로, 아니면 CNT개의 fd i에 부모의 fd SRC[i]를
+ * 복제한다. 파일 위치는 부모와 따로 움직여야 하므로 파일 객체마다 한 번씩 복제하되,
+ * 부모에서 같은 객체를 가리키던 fd들은 자식에서도 같은 복제본을 공유한다. */
+static bool copy_fds(struct thread *parent, const int *src, int cnt)
+{
+    struct thread *current = thread_current();
+    int i;
+
+    if (!process_fdt_reserve(current, src != NULL ? cnt : parent->fd_cap))
+        return false;
+
+    /* thread_create()가 넣어 둔 표준 입출력도 부모를 따른다. */
+    memset(current->fdt, 0, current->fd_cap * sizeof *current->fdt);
+    memset(current->fd_map, 0, FD_MAP_WORDS(current->fd_cap) * sizeof *current->fd_map);
+
+    lock_acquire(&filesys_lock);
+    for (i = next_fd(parent, src, cnt, 0); i >= 0; i = next_fd(parent, src, cnt, i + 1))
+    {
+        struct file *f = source_file(parent, src, i);
+        if (f == NULL)
+            continue;
+        if (!process_is_std_file(f))
+        {
+            int j = -1;
+            if (src != NULL || file_is_shared(f))
+                for (j = next_fd(parent, src, cnt, 0); j < i && source_file(parent, src, j) != f;
+                     j = next_fd(parent, src, cnt, j + 1))
+                    continue;
+            f = j >= 0 && j < i ? file_share(current->fdt[j]) : file_duplicate(f);
+            if (f == NULL)
+                break;
+        }
+        current->fdt[i] = f;
+        current->fd_map[i / FD_MAP_BITS] |= 1ULL << (i % FD_MAP_BITS);
+    }
+    lock_release(&filesys_lock);
+    return i < 0;
+}
+/*-------------------------[project 2]-------------------------*/
+
 /* A thread function that copies parent's execution context.
  * Hint) parent->tf does not hold the userland context of the process.
  *       That is, you are required to pass second argument of process_fork to
@@ -182,35 +284,83 @@ static void __do_fork(void *aux)
         if (!pml4_for_each(parent->pml4, duplicate_pte, parent))
             goto error;
     #endif
-        if (parent->next_fd >= FDCOUNT_LIMIT)
-            goto error;
-
     /*-------------------------[project 2]-------------------------*/
-    current->fdt[0] = parent->fdt[0];
-    current->fdt[1] = parent->fdt[1];
-
-    for (int i = 2; i < FDCOUNT_LIMIT; i++)
-    {
-        struct file *f = parent->fdt[i];
-        if (f == NULL)
-        {
-            continue;
-        }
-        current->fdt[i] = file_duplicate(f);
-    }
+    if (!copy_fds(parent, NULL, 0))
+        goto error;
 
-    current->next_fd = parent->next_fd;
-    sema_up(&current->fork_sema);
+    sema_up(&current->exit_rec->fork_sema);
     /*-------------------------[project 2]-------------------------*/
 
     /* Finally, switch to the newly created process. */
     if (succ)
         do_iret(&if_);
 error:
-    current->exit_status = TID_ERROR;
-    sema_up(&current->fork_sema);
+    current->exit_rec->fork_failed = true;
+    sema_up(&current->exit_rec->fork_sema);
+    exit(TID_ERROR);
+}
+
+/*-------------------------[project 2]-------------------------*/
+/* ARGS->path 프로그램을 ARGS->argv로 실행하는 자식 프로세스를 만드는 함수.
+ * fork와 달리 부모의 주소 공간은 복제하지 않고 자식이 곧바로 load()한다.
+ * 자식이 프로그램을 다 올릴 때까지 기다리므로, 반환한 뒤에는 ARGS를 해제해도 된다.
+ * 자식의 tid를 반환하고, 프로그램을 올리지 못했으면 TID_ERROR를 반환한다. */
+tid_t process_spawn(struct spawn_args *args)
+{
+    args->parent = thread_current();
+
+    tid_t tid = thread_create_child(args->path, PRI_DEFAULT, __do_spawn, args);
+    if (tid == TID_ERROR)
+        return TID_ERROR;
+
+    struct exit_record *child = thread_get_child(tid);
+
+    sema_down(&child->fork_sema);
+
+    if (child->fork_failed)
+    {
+        sema_down(&child->wait_sema);
+        thread_forget_child(child);
+        return TID_ERROR;
+    }
+
+    return tid;
+}
+
+/* spawn으로 만든 자식이 실행하는 스레드 함수.
+   fd를 물려받고 프로그램을 올린 뒤 부모를 깨우고 사용자 모드로 넘어간다. */
+static void __do_spawn(void *aux)
+{
+    struct spawn_args *args = aux;
+    struct thread *current = thread_current();
+    struct intr_frame if_;
+
+    memset(&if_, 0, sizeof if_);
+    if_.ds = if_.es = if_.ss = SEL_UDSEG;
+    if_.cs = SEL_UCSEG;
+    if_.eflags = FLAG_IF | FLAG_MBS;
+
+#ifdef VM
+    supplemental_page_table_init(&current->spt);
+#endif
+    process_init();
+
+    if (!copy_fds(args->parent, args->fds, args->fd_cnt))
+        goto error;
+    if (!load(args->path, &if_))
+        goto error;
+    argument_stack(args->argv, args->argc, &if_);
+
+    sema_up(&current->exit_rec->fork_sema);
+    do_iret(&if_);
+    NOT_REACHED();
+
+error:
+    current->exit_rec->fork_failed = true;
+    sema_up(&current->exit_rec->fork_sema);
     exit(TID_ERROR);
 }
+/*-------------------------[project 2]-------------------------*/
 
 /* Switch the current execution context to the f_name.
  * Returns -1 on fail. */
@@ -295,16 +445,15 @@ int process_exec(void *f_name)
 종료 시 자식 프로세스의 exit_status를 반환하는 함수 */
 int process_wait(tid_t child_tid UNUSED)
 {
-    struct thread *child = get_child_process(child_tid);
+    struct exit_record *child = thread_get_child(child_tid);
     if (child == NULL)
     {
         return -1;
     }
     sema_down(&child->wait_sema);
-    // thread_exit();
     int exit_status = child->exit_status;
-    list_remove(&child->child_elem);
-    sema_up(&child->free_sema);
+    rusage_add(&thread_current()->child_rusage, &child->rusage); /* 거둔 자식의 사용량을 합산 */
+    thread_forget_child(child);
     return exit_status;
 }
 
@@ -313,19 +462,44 @@ void process_exit(void)
 {
     struct thread *curr = thread_current();
 
-    for (int i = 0; i < FDCOUNT_LIMIT; i++)
+    /* 열려 있는 fd만 골라 닫는다. */
+    for (int i = process_next_fd(curr, 0); i >= 0; i = process_next_fd(curr, i + 1))
     {
         close(i);
     }
-    palloc_free_multiple(curr->fdt, FDT_PAGES);
+    free(curr->fdt);
+    free(curr->fd_map);
+    curr->fdt = NULL;
+    curr->fd_map = NULL;
+    curr->fd_cap = 0;
     file_close(curr->running);
 
-    sema_up(&curr->wait_sema);
-    sema_down(&curr->free_sema);
+    /* 종료 상태는 레코드에 남기므로 부모를 기다리지 않고 바로 자원을 반납한다. */
+    if (curr->exit_rec != NULL)
+    {
+        curr->exit_rec->exit_status = curr->exit_status;
+        curr->exit_rec->rusage = curr->rusage;
+        rusage_add(&curr->exit_rec->rusage, &curr->child_rusage);
+        sema_up(&curr->exit_rec->wait_sema);
+        thread_release_record(curr->exit_rec);
+        curr->exit_rec = NULL;
+    }
+    thread_release_children();
 
     process_cleanup();
 }
 
+/* SRC의 사용량을 DST에 더하는 함수 */
+static void rusage_add(struct rusage *dst, const struct rusage *src)
+{
+    dst->user_ticks += src->user_ticks;
+    dst->kernel_ticks += src->kernel_ticks;
+    dst->page_faults += src->page_faults;
+    dst->sectors_read += src->sectors_read;
+    dst->sectors_written += src->sectors_written;
+    dst->context_switches += src->context_switches;
+}
+
 /* 현재 프로세스의 자원을 해제하는 함수 */
 static void process_cleanup(void)
 {
@@ -419,8 +593,38 @@ struct ELF64_PHDR
 #define ELF ELF64_hdr
 #define Phdr ELF64_PHDR
 
+/* A PT_LOAD segment, in the terms of load_segment(). */
+struct exec_seg
+{
+    uint64_t file_page;  /* Page-aligned file offset. */
+    uint64_t mem_page;   /* Page-aligned user virtual address. */
+    uint32_t read_bytes; /* Bytes to read from the file. */
+    uint32_t zero_bytes; /* Bytes to zero after them. */
+    bool writable;       /* Mapped writable? */
+};
+
+/* What load() needs to know about an executable once its headers
+ * have been read and validated.  It is cached on the executable's
+ * inode, so executing the same binary again skips the headers. */
+struct exec_info
+{
+    uint64_t entry;         /* Entry point. */
+    int seg_cnt;            /* Number of elements in SEGS. */
+    struct exec_seg segs[]; /* Segments to load. */
+};
+
+/* Number of recently executed inodes kept open, so that their
+ * exec_info outlives the processes that ran them. */
+#define EXEC_PIN_CNT 8
+
+/* Recently executed inodes, most recent first.
+ * Protected by filesys_lock. */
+static struct inode *exec_pins[EXEC_PIN_CNT];
+
 static bool setup_stack(struct intr_frame *if_);
 static bool validate_segment(const struct Phdr *, struct file *);
+static struct exec_info *parse_exec(struct file *file);
+static void pin_exec(struct inode *inode);
 static bool load_segment(struct file *file, off_t ofs, uint8_t *upage,
                          uint32_t read_bytes, uint32_t zero_bytes,
                          bool writable);
@@ -433,9 +637,9 @@ static bool
 load(const char *file_name, struct intr_frame *if_)
 {
     struct thread *t = thread_current();
-    struct ELF ehdr;
+    struct exec_info *info;
+    struct inode *inode;
     struct file *file = NULL;
-    off_t file_ofs;
     bool success = false;
     int i;
 
@@ -459,34 +663,93 @@ load(const char *file_name, struct intr_frame *if_)
     /* 현재 오픈한 파일에 다른내용 쓰지 못하게 함 */
     file_deny_write(file);
 
+    /* Read and verify the headers, unless an earlier exec of the same
+     * inode already did.  Writes are denied from here on, so the
+     * cached copy cannot go stale while we use it. */
+    inode = file_get_inode(file);
+    lock_acquire(&filesys_lock);
+    info = inode_get_exec_info(inode);
+    if (info == NULL)
+    {
+        info = parse_exec(file);
+        if (info != NULL)
+            inode_set_exec_info(inode, info);
+    }
+    if (info != NULL)
+        pin_exec(inode);
+    lock_release(&filesys_lock);
+    if (info == NULL)
+    {
+        printf("load: %s: error loading executable\n", file_name);
+        goto done;
+    }
+
+    for (i = 0; i < info->seg_cnt; i++)
+    {
+        struct exec_seg *seg = &info->segs[i];
+        if (!load_segment(file, seg->file_page, (void *)seg->mem_page,
+                          seg->read_bytes, seg->zero_bytes, seg->writable))
+            goto done;
+    }
+
+    /* Set up stack. */
+    if (!setup_stack(if_))
+        goto done;
+
+    /* Start address. */
+    if_->rip = info->entry;
+
+    /* TODO: Your code goes here.
+     * TODO: Implement argument passing (see project2/argument_passing.html). */
+
+    success = true;
+
+done:
+    /* We arrive here whether the load is successful or not. */
+    // file_close(file);
+    return success;
+}
+
+/* Reads and verifies the executable header of FILE and all of its
+ * program headers, the latter in a single read, and returns the
+ * result as a new exec_info, or a null pointer if FILE is not an
+ * executable we can load. */
+static struct exec_info *
+parse_exec(struct file *file)
+{
+    struct ELF ehdr;
+    struct Phdr *phdrs = NULL;
+    struct exec_info *info = NULL;
+    off_t phdrs_size;
+    int i;
+
     /* Read and verify executable header. */
-    /* Read and verify executable header. */
-    if (file_read(file, &ehdr, sizeof ehdr) != sizeof ehdr 
+    if (file_read_at(file, &ehdr, sizeof ehdr, 0) != sizeof ehdr 
     || memcmp(ehdr.e_ident, "\177ELF\2\1\1", 7) 
     || ehdr.e_type != 2 
     || ehdr.e_machine != 0x3E // amd64
     || ehdr.e_version != 1 
     || ehdr.e_phentsize != sizeof(struct Phdr) 
     || ehdr.e_phnum > 1024)
-    {
-        printf("load: %s: error loading executable\n", file_name);
-        goto done;
-    }
+        return NULL;
 
     /* Read program headers. */
-    file_ofs = ehdr.e_phoff;
+    phdrs_size = ehdr.e_phnum * sizeof *phdrs;
+    if (ehdr.e_phoff > (uint64_t)file_length(file))
+        return NULL;
+    phdrs = malloc(phdrs_size);
+    info = malloc(sizeof *info + ehdr.e_phnum * sizeof *info->segs);
+    if (phdrs == NULL || info == NULL
+        || file_read_at(file, phdrs, phdrs_size, ehdr.e_phoff) != phdrs_size)
+        goto fail;
+
+    info->entry = ehdr.e_entry;
+    info->seg_cnt = 0;
     for (i = 0; i < ehdr.e_phnum; i++)
     {
-        struct Phdr phdr;
-
-        if (file_ofs < 0 || file_ofs > file_length(file))
-            goto done;
-        file_seek(file, file_ofs);
+        struct Phdr *phdr = &phdrs[i];
 
-        if (file_read(file, &phdr, sizeof phdr) != sizeof phdr)
-            goto done;
-        file_ofs += sizeof phdr;
-        switch (phdr.p_type)
+        switch (phdr->p_type)
         {
         case PT_NULL:
         case PT_NOTE:
@@ -498,55 +761,72 @@ load(const char *file_name, struct intr_frame *if_)
         case PT_DYNAMIC:
         case PT_INTERP:
         case PT_SHLIB:
-            goto done;
+            goto fail;
         case PT_LOAD:
-            if (validate_segment(&phdr, file))
+            if (validate_segment(phdr, file))
             {
-                bool writable = (phdr.p_flags & PF_W) != 0;
-                uint64_t file_page = phdr.p_offset & ~PGMASK;
-                uint64_t mem_page = phdr.p_vaddr & ~PGMASK;
-                uint64_t page_offset = phdr.p_vaddr & PGMASK;
-                uint32_t read_bytes, zero_bytes;
-                if (phdr.p_filesz > 0)
+                struct exec_seg *seg = &info->segs[info->seg_cnt++];
+                uint64_t page_offset = phdr->p_vaddr & PGMASK;
+
+                seg->writable = (phdr->p_flags & PF_W) != 0;
+                seg->file_page = phdr->p_offset & ~PGMASK;
+                seg->mem_page = phdr->p_vaddr & ~PGMASK;
+                if (phdr->p_filesz > 0)
                 {
                     /* Normal segment.
                      * Read initial part from disk and zero the rest. */
-                    read_bytes = page_offset + phdr.p_filesz;
-                    zero_bytes = (ROUND_UP(page_offset + phdr.p_memsz, PGSIZE) - read_bytes);
+                    seg->read_bytes = page_offset + phdr->p_filesz;
+                    seg->zero_bytes = (ROUND_UP(page_offset + phdr->p_memsz, PGSIZE) - seg->read_bytes);
                 }
                 else
                 {
                     /* Entirely zero.
                      * Don't read anything from disk. */
-                    read_bytes = 0;
-                    zero_bytes = ROUND_UP(page_offset + phdr.p_memsz, PGSIZE);
+                    seg->read_bytes = 0;
+                    seg->zero_bytes = ROUND_UP(page_offset + phdr->p_memsz, PGSIZE);
                 }
-                if (!load_segment(file, file_page, (void *)mem_page,
-                                  read_bytes, zero_bytes, writable))
-                    goto done;
             }
             else
-                goto done;
+                goto fail;
             break;
         }
     }
+    free(phdrs);
+    return info;
 
-    /* Set up stack. */
-    if (!setup_stack(if_))
-        goto done;
+fail:
+    free(phdrs);
+    free(info);
+    return NULL;
+}
 
-    /* Start address. */
-    if_->rip = ehdr.e_entry;
+/* Keeps INODE open as one of the EXEC_PIN_CNT most recently
+ * executed inodes, closing the least recent one if needed.
+ * Inodes that have been removed meanwhile are let go, so that
+ * their blocks are freed.  Must be called with filesys_lock held. */
+static void
+pin_exec(struct inode *inode)
+{
+    int i, j;
 
-    /* TODO: Your code goes here.
-     * TODO: Implement argument passing (see project2/argument_passing.html). */
+    ASSERT(lock_held_by_current_thread(&filesys_lock));
 
-    success = true;
+    /* Drop INODE itself and removed inodes, keeping the order. */
+    for (i = j = 0; i < EXEC_PIN_CNT; i++)
+    {
+        struct inode *pin = exec_pins[i];
+        if (pin == inode || (pin != NULL && inode_is_removed(pin)))
+            inode_close(pin);
+        else
+            exec_pins[j++] = pin;
+    }
+    for (; j < EXEC_PIN_CNT; j++)
+        exec_pins[j] = NULL;
 
-done:
-    /* We arrive here whether the load is successful or not. */
-    // file_close(file);
-    return success;
+    /* Put INODE first. */
+    inode_close(exec_pins[EXEC_PIN_CNT - 1]);
+    memmove(exec_pins + 1, exec_pins, (EXEC_PIN_CNT - 1) * sizeof *exec_pins);
+    exec_pins[0] = inode_reopen(inode);
 }
 
 /* Checks whether PHDR describes a valid, loadable segment in
@@ -633,25 +913,6 @@ void argument_stack(char **parse, int count, struct intr_frame *_if)
     _if->R.rsi = _if->rsp + 8;
 }
 
-struct thread *get_child_process(int pid)
-{
-    struct thread *curr = thread_current();
-    if (list_empty(&curr->children_list))
-    {
-        return NULL;
-    }
-
-    for (struct list_elem *e = list_begin(&curr->children_list); e != list_end(&curr->children_list); e = list_next(e))
-    {
-        struct thread *t = list_entry(e, struct thread, child_elem);
-        if (t->tid == pid)
-        {
-            return t;
-        }
-    }
-    return NULL;
-}
-
 // void remove_child_process(struct thread *cp)
 // {
 // 	list_remove(&cp->child_elem);
@@ -698,6 +959,24 @@ load_segment(struct file *file, off_t ofs, uint8_t *upage,
         size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
         size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
+        /* A 2 MB aligned run of zero pages is backed by a huge page,
+         * if enabled and one is available. */
+        if (user_huge_pages && read_bytes == 0 && zero_bytes >= HUGE_PGSIZE
+            && ((uint64_t)upage & HUGE_PGMASK) == 0)
+        {
+            uint8_t *hpage = palloc_get_huge_page(PAL_USER | PAL_ZERO);
+            if (hpage != NULL)
+            {
+                if (pml4_set_huge_page(thread_current()->pml4, upage, hpage, writable))
+                {
+                    zero_bytes -= HUGE_PGSIZE;
+                    upage += HUGE_PGSIZE;
+                    continue;
+                }
+                palloc_free_huge_page(hpage);
+            }
+        }
+
         /* Get a page of memory. */
         uint8_t *kpage = palloc_get_page(PAL_USER);
         if (kpage == NULL)
@@ -770,11 +1049,25 @@ install_page(void *upage, void *kpage, bool writable)
  * upper block. */
 
 static bool
-lazy_load_segment(struct page *page, void *aux)
+lazy_load_segment(struct page *page, void *aux_)
 {
-    /* TODO: Load the segment from the file */
-    /* TODO: This called when the first page fault occurs on address VA. */
-    /* TODO: VA is available when calling this function. */
+    struct lazy_load_aux *aux = aux_;
+    uint8_t *kpage = page->frame->kva;
+    bool held = lock_held_by_current_thread(&filesys_lock);
+    bool success;
+
+    /* Faults may hit in the middle of a syscall that already holds
+     * the file system lock. */
+    if (!held)
+        lock_acquire(&filesys_lock);
+    success = file_read_at(aux->file, kpage, aux->read_bytes, aux->ofs) == (int)aux->read_bytes;
+    if (!held)
+        lock_release(&filesys_lock);
+
+    if (success)
+        memset(kpage + aux->read_bytes, 0, aux->zero_bytes);
+    free(aux);
+    return success;
 }
 
 /* Loads a segment starting at offset OFS in FILE at address
@@ -799,6 +1092,12 @@ load_segment(struct file *file, off_t ofs, uint8_t *upage,
     ASSERT(pg_ofs(upage) == 0);
     ASSERT(ofs % PGSIZE == 0);
 
+    /* The segment is one fault-around region with its own file handle. */
+    struct vm_region *region = vm_region_create(&thread_current()->spt, upage,
+                                                upage + read_bytes + zero_bytes, file);
+    if (region == NULL)
+        return false;
+
     while (read_bytes > 0 || zero_bytes > 0)
     {
         /* Do calculate how to fill this page.
@@ -807,18 +1106,33 @@ load_segment(struct file *file, off_t ofs, uint8_t *upage,
         size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
         size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
-        /* TODO: Set up aux to pass information to the lazy_load_segment. */
-        void *aux = NULL;
-        if (!vm_alloc_page_with_initializer(VM_ANON, upage,
-                                            writable, lazy_load_segment, aux))
+        struct lazy_load_aux *aux = malloc(sizeof *aux);
+        if (aux == NULL)
+            return false;
+        aux->file = region->file;
+        aux->ofs = ofs;
+        aux->read_bytes = page_read_bytes;
+        aux->zero_bytes = page_zero_bytes;
+        /* 읽기 전용 페이지는 파일 페이지로 만들어 다른 프로세스와 공유하고,
+         * 쓰기 가능한 페이지만 익명 페이지로 각자 복사본을 가진다. */
+        bool success = writable
+                           ? vm_alloc_page_with_initializer(VM_ANON, upage, true,
+                                                            lazy_load_segment, aux)
+                           : vm_alloc_page_with_initializer(VM_FILE, upage, false,
+                                                            NULL, aux);
+        if (!success)
+        {
+            free(aux);
             return false;
+        }
 
         /* Advance. */
         read_bytes -= page_read_bytes;
         zero_bytes -= page_zero_bytes;
+        ofs += page_read_bytes;
         upage += PGSIZE;
     }
-    frame return true;
+    return true;
 }
 
 /* Create a PAGE of stack at the USER_STACK. Return true on success. */
@@ -828,10 +1142,13 @@ setup_stack(struct intr_frame *if_)
     bool success = false;
     void *stack_bottom = (void *)(((uint8_t *)USER_STACK) - PGSIZE);
 
-    /* TODO: Map the stack on stack_bottom and claim the page immediately.
-     * TODO: If success, set the rsp accordingly.
-     * TODO: You should mark the page is stack. */
-    /* TODO: Your code goes here */
+    /* Map the stack on stack_bottom and claim the page immediately. */
+    if (vm_alloc_page(VM_ANON | VM_MARKER_0, stack_bottom, true))
+    {
+        success = vm_claim_page(stack_bottom);
+        if (success)
+            if_->rsp = USER_STACK;
+    }
 
     return success;
 }
@@ -1,21 +1,33 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #include "threads/loader.h"
 #include "userprog/gdt.h"
 #include "threads/flags.h"
 #include "intrinsic.h"
 /*-------------------------[project 2]-------------------------*/
 #include "filesys/filesys.h"
+#include "filesys/file.h"
 #include "userprog/process.h"
+#include "userprog/exception.h"
+#include "filesys/directory.h"
 #include "devices/input.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/mmu.h"
+#include <memstat.h>
+#include <rusage.h>
+#include <sysring.h>
 
 void syscall_entry(void);
 void syscall_handler(struct intr_frame *);
 void check_address(const void *addr);
+static void check_buffer(const void *buffer, unsigned size, bool write);
+static bool copy_in_string(char *dst, const char *ustr, size_t size);
 
 void halt(void);
 void exit(int status);
@@ -30,7 +42,12 @@ void seek(int fd, unsigned position);
 void close(int fd);
 tid_t fork(const char *thread_name, struct intr_frame *f);
 int wait(tid_t pid);
+tid_t spawn(const char *path, char *const argv[], const int *fds, int fd_cnt);
 unsigned tell(int fd);
+int dup2(int oldfd, int newfd);
+int memstat(struct memstat *ms);
+int getrusage(int who, struct rusage *usage);
+int sysring_enter(struct sysring *ring);
 
 struct file *process_get_file(int fd);
 void process_close_file(int fd);
@@ -67,108 +84,148 @@ void syscall_init(void)
 			  FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
 
 	/* project2 */
-	lock_init(&filesys_lock);
+	lock_init_named(&filesys_lock, "filesys_lock");
 	/* project2 */
 }
 
-/* The main system call interface */
-void syscall_handler(struct intr_frame *f)
+/* 시스템콜 구현 함수. 모든 인자는 정수 레지스터로 넘어가므로
+   실제 함수의 인자 개수나 타입과 상관없이 이 형태로 호출할 수 있다. */
+typedef uint64_t syscall_func(uint64_t, uint64_t, uint64_t,
+							  uint64_t, uint64_t, uint64_t);
+
+/* 반환값을 rax에 넣는 방법 */
+enum syscall_ret
+{
+	RET_VOID,	/* 반환값 없음 */
+	RET_INT,	/* int: 부호 확장 */
+	RET_UINT,	/* unsigned: 0 확장 */
+	RET_BOOL,	/* bool: 하위 바이트만 유효 */
+};
+
+/* 시스템콜 하나의 정보 */
+struct syscall_desc
+{
+	syscall_func *func;		/* 구현 함수 */
+	uint8_t argc;			/* 레지스터 인자 개수 */
+	uint8_t ret;			/* enum syscall_ret */
+	bool frame;				/* 인자 뒤에 intr_frame을 넘기는지 */
+	bool batch;				/* sysring으로 제출할 수 있는지 */
+	const char *name;
+};
+
+/* void (*)(void)를 거치면 서로 다른 함수 타입 사이의 변환 경고가 나지 않는다. */
+#define SYSCALL(NR, FUNC, ARGC, RET, FRAME, BATCH) \
+	[NR] = {(syscall_func *)(void (*)(void))(FUNC), ARGC, RET, FRAME, BATCH, #FUNC}
+
+/* exec는 실패했을 때만 돌아온다. */
+static void exec_or_exit(const char *cmd_line)
+{
+	exec(cmd_line);
+	exit(-1);
+}
+
+/* 시스템콜 번호로 찾는 디스패치 테이블. 비어 있는 번호는 구현되지 않은 시스템콜이다. */
+static const struct syscall_desc syscall_table[] = {
+	SYSCALL(SYS_HALT, halt, 0, RET_VOID, false, false),
+	SYSCALL(SYS_EXIT, exit, 1, RET_VOID, false, false),
+	SYSCALL(SYS_FORK, fork, 1, RET_INT, true, false),
+	SYSCALL(SYS_EXEC, exec_or_exit, 1, RET_VOID, false, false),
+	SYSCALL(SYS_WAIT, wait, 1, RET_INT, false, false),
+	SYSCALL(SYS_CREATE, create, 2, RET_BOOL, false, true),
+	SYSCALL(SYS_REMOVE, remove, 1, RET_BOOL, false, true),
+	SYSCALL(SYS_OPEN, open, 1, RET_INT, false, true),
+	SYSCALL(SYS_FILESIZE, filesize, 1, RET_INT, false, true),
+	SYSCALL(SYS_READ, read, 3, RET_INT, false, true),
+	SYSCALL(SYS_WRITE, write, 3, RET_INT, false, true),
+	SYSCALL(SYS_SEEK, seek, 2, RET_VOID, false, true),
+	SYSCALL(SYS_TELL, tell, 1, RET_UINT, false, true),
+	SYSCALL(SYS_CLOSE, close, 1, RET_VOID, false, true),
+	SYSCALL(SYS_DUP2, dup2, 2, RET_INT, false, true),
+	SYSCALL(SYS_MEMSTAT, memstat, 1, RET_INT, false, false),
+	SYSCALL(SYS_SYSRING_ENTER, sysring_enter, 1, RET_INT, false, false),
+	SYSCALL(SYS_SPAWN, spawn, 4, RET_INT, false, false),
+	SYSCALL(SYS_GETRUSAGE, getrusage, 2, RET_INT, false, false),
+};
+
+/* 번호 NR의 시스템콜 정보를 반환한다. 없으면 NULL. */
+static const struct syscall_desc *syscall_lookup(uint64_t nr)
+{
+	if (nr >= sizeof syscall_table / sizeof *syscall_table
+		|| syscall_table[nr].func == NULL)
+		return NULL;
+	return &syscall_table[nr];
+}
+
+/* D를 ARGS로 호출하고, rax에 넣을 값을 반환한다.
+   D가 intr_frame을 받으면 F를 넘긴다. */
+static uint64_t syscall_call(const struct syscall_desc *d,
+							 const uint64_t args[6], struct intr_frame *f)
 {
-	switch (f->R.rax) // rax값이 들어가야함.
+	uint64_t a[6] = {0};
+	uint64_t ret;
+
+	for (int i = 0; i < d->argc; i++)
+		a[i] = args[i];
+	if (d->frame)
+		a[d->argc] = (uint64_t)f;
+
+	ret = d->func(a[0], a[1], a[2], a[3], a[4], a[5]);
+	switch (d->ret)
 	{
-	case SYS_HALT:
-		halt();
-		break;
-	case SYS_EXIT:
-		exit(f->R.rdi);
-		break;
-	case SYS_FORK:
-		f->R.rax = fork(f->R.rdi, f);
-		break;
-	case SYS_EXEC:
-		if (exec(f->R.rdi) == -1)
-		{
-			exit(-1);
-		}
-		break;
-	case SYS_WAIT:
-		f->R.rax = wait(f->R.rdi);
-		break;
-	case SYS_CREATE:
-		f->R.rax = create(f->R.rdi, f->R.rsi);
-		break;
-	case SYS_REMOVE:
-		f->R.rax = remove(f->R.rdi);
-		break;
-	case SYS_OPEN:
-		f->R.rax = open(f->R.rdi);
-		break;
-	case SYS_FILESIZE:
-		f->R.rax = filesize(f->R.rdi);
-		break;
-	case SYS_READ:
-		f->R.rax = read(f->R.rdi, f->R.rsi, f->R.rdx);
-		break;
-	case SYS_WRITE:
-		f->R.rax = write(f->R.rdi, f->R.rsi, f->R.rdx);
-		break;
-	case SYS_SEEK:
-		seek(f->R.rdi, f->R.rsi);
-		break;
-	case SYS_TELL:
-		f->R.rax = tell(f->R.rdi);
-		break;
-	case SYS_CLOSE:
-		close(f->R.rdi);
-		break;
-	// case SYS_DUP2:
-	// 	dup2(f->R.rdi, f->R.rsi);
-	// 	break;
-	// case SYS_MMAP:
-	// 	mmap(f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10, f->R.r8);
-	// 	break;
-	// case SYS_MUNMAP:
-	// 	munmap(f->R.rdi);
-	// 	break;
-	// case SYS_CHDIR:
-	// 	chdir(f->R.rdi);
-	// 	break;
-	// case SYS_MKDIR:
-	// 	mkdir(f->R.rdi);
-	// 	break;
-	// case SYS_READDIR:
-	// 	readdir(f->R.rdi, f->R.rsi);
-	// 	break;
-	// case SYS_ISDIR:
-	// 	isdir(f->R.rdi);
-	// 	break;
-	// case SYS_INUMBER:
-	// 	inumber(f->R.rdi);
-	// 	break;
-	// case SYS_SYMLINK:
-	// 	symlink(f->R.rdi, f->R.rsi);
-	// 	break;
-	// case SYS_MOUNT:
-	// 	mount(f->R.rdi, f->R.rsi, f->R.rdx);
-	// 	break;
-	// case SYS_UMOUNT:
-	// 	umount(f->R.rdi);
-	// 	break;
+	case RET_INT:
+		return (int64_t)(int)ret;
+	case RET_UINT:
+		return (unsigned)ret;
+	case RET_BOOL:
+		return (uint8_t)ret != 0;
 	default:
-		exit(-1);
-		break;
+		return 0;
 	}
 }
 
-/* 입력된 주소가 유효한 주소인지 확인하고, 그렇지 않으면 프로세스를 종료시키는 함수 */
+/* The main system call interface */
+void syscall_handler(struct intr_frame *f)
+{
+	const struct syscall_desc *d = syscall_lookup(f->R.rax);
+	uint64_t args[6] = {f->R.rdi, f->R.rsi, f->R.rdx,
+						f->R.r10, f->R.r8, f->R.r9};
+	uint64_t ret;
+
+	TRACE(TRACE_SYSCALL_ENTER, f->R.rax, 0);
+	if (d == NULL)
+		exit(-1);
+
+	ret = syscall_call(d, args, f);
+	TRACE(TRACE_SYSCALL_EXIT, f->R.rax, ret);
+	if (d->ret != RET_VOID)
+		f->R.rax = ret;
+}
+
+/* 입력된 주소가 유효한 주소인지 확인하고, 그렇지 않으면 프로세스를 종료시키는 함수.
+   페이지 테이블을 뒤지는 대신 직접 읽어 보고, 폴트가 나면 실패로 처리한다. */
 void check_address(const void *addr)
 {
-	struct thread *curr = thread_current();
+	if (addr == NULL || !probe_user((void *)addr, 1, false))
+		exit(-1);
+}
 
-	if (is_kernel_vaddr(addr) || addr == NULL || pml4_get_page(curr->pml4, addr) == NULL)
-	{
+/* BUFFER부터 SIZE 바이트의 모든 페이지가 읽기(WRITE면 쓰기) 가능한지 확인하고,
+   그렇지 않으면 프로세스를 종료시키는 함수 */
+static void check_buffer(const void *buffer, unsigned size, bool write)
+{
+	if (!probe_user((void *)buffer, size, write))
 		exit(-1);
-	}
+}
+
+/* 사용자 문자열 USTR을 SIZE 바이트 크기의 커널 버퍼 DST로 복사하는 함수.
+   잘못된 주소면 프로세스를 종료시키고, 문자열이 DST에 다 들어가지 않으면 false를 반환한다. */
+static bool copy_in_string(char *dst, const char *ustr, size_t size)
+{
+	int len = strncpy_from_user(dst, ustr, size);
+
+	if (len < 0)
+		exit(-1);
+	return (size_t)len < size;
 }
 
 // void get_argument(void *rsp, int **arg, int count)
@@ -200,8 +257,11 @@ void exit(int status)
 /* 'function함수를 수행하는 스레드'를 생성하는 시스템콜 함수 */
 bool create(const char *file, unsigned initial_size)
 {
-	check_address(file);
-	if (filesys_create(file, initial_size))
+	char name[NAME_MAX + 1];
+
+	if (!copy_in_string(name, file, sizeof name))
+		return false;
+	if (filesys_create(name, initial_size))
 	{
 		return true;
 	}
@@ -214,9 +274,11 @@ bool create(const char *file, unsigned initial_size)
 /* 주어진 파일을 삭제하는 시스템콜 함수 */
 bool remove(const char *file)
 {
-	check_address(file);
+	char name[NAME_MAX + 1];
 
-	if (filesys_remove(file))
+	if (!copy_in_string(name, file, sizeof name))
+		return false;
+	if (filesys_remove(name))
 	{
 		return true;
 	}
@@ -237,13 +299,18 @@ int filesize(int fd)
 /* 자식프로세스를 생성하고 프로그램을 실행시키는 시스템콜 함수 */
 int exec(const char *cmd_line)
 {
-	check_address(cmd_line);
-
-	int size = strlen(cmd_line) + 1;
-	char *fn_copy = palloc_get_page(PAL_ZERO);
+	char *fn_copy = palloc_get_page(0);
 	if (fn_copy == NULL)
 		exit(-1);
-	strlcpy(fn_copy, cmd_line, size);
+	int len = strncpy_from_user(fn_copy, cmd_line, PGSIZE);
+	if (len < 0 || len == PGSIZE)
+	{
+		palloc_free_page(fn_copy);
+		/* 한 페이지를 넘는 명령행은 받지 않는다. */
+		if (len < 0)
+			exit(-1);
+		return -1;
+	}
 
 	if (process_exec(fn_copy) == -1)
 		return -1;
@@ -256,9 +323,12 @@ int exec(const char *cmd_line)
 /* 인자로 받은 file을 열어, 해당 파일을 가리키는 포인터를 현재 쓰레드의 fdt에 추가하는 시스템콜 함수 */
 int open(const char *file)
 {
-	check_address(file);
+	char name[NAME_MAX + 1];
+
+	if (!copy_in_string(name, file, sizeof name))
+		return -1;
 	lock_acquire(&filesys_lock);
-	struct file *fileobj = filesys_open(file);
+	struct file *fileobj = filesys_open(name);
 
 	if (fileobj == NULL)
 	{
@@ -275,17 +345,31 @@ int open(const char *file)
 	return fd;
 }
 
+/* read()와 write()는 사용자 버퍼를 미리 검사하지 않고, 커널 페이지를 거쳐
+   한 페이지씩 copy_to_user()/copy_from_user()로 옮긴다.  잘못된 주소는 실제로
+   복사할 때 드러나 프로세스를 종료시키고, 버퍼의 페이지를 미리 건드려
+   mmap이나 파일 페이지를 더럽히는 일이 없다. */
+
+/* 키보드에서 SIZE 바이트까지 BUF로 읽고, 읽은 바이트 수를 반환하는 함수.
+   널 문자를 읽으면 거기까지만 읽는다. */
+static int read_stdin(uint8_t *buf, unsigned size)
+{
+	unsigned i;
+
+	for (i = 0; i < size; i++)
+		if ((buf[i] = input_getc()) == '\0')
+			return i + 1;
+	return size;
+}
+
 /* 열린파일의 데이터를 읽는 시스템콜 함수*/
 int read(int fd, void *buffer, unsigned size)
 {
-	check_address(buffer);	
-	check_address(buffer + size - 1); 
-
-	unsigned char *buf = buffer;
-	int read_count;
 	struct file *fileobj = process_get_file(fd);
+	uint8_t *bounce;
+	unsigned read_count = 0;
 
-	if (fileobj == NULL)
+	if (fileobj == NULL || fileobj == STDOUT)
 	{
 		return -1;
 	}
@@ -295,60 +379,91 @@ int read(int fd, void *buffer, unsigned size)
 		return 0;
 	}
 
-	if (fileobj == STDIN)
-	{
-		char key;
-		for (int read_count = 0; read_count < size; read_count++)
-		{
-			key = input_getc();
-			*buf++ = key;
-			if (key == '\0')
-			{ 
-				break;
-			}
-		}
-	}
-	else if (fileobj == STDOUT)
+	bounce = palloc_get_page(0);
+	if (bounce == NULL)
 	{
 		return -1;
 	}
-	else
+	while (read_count < size)
 	{
-		lock_acquire(&filesys_lock);
-		read_count = file_read(fileobj, buffer, size);
-		lock_release(&filesys_lock);
+		unsigned chunk = size - read_count < PGSIZE ? size - read_count : PGSIZE;
+		int n;
+
+		if (fileobj == STDIN)
+		{
+			n = read_stdin(bounce, chunk);
+		}
+		else
+		{
+			lock_acquire(&filesys_lock);
+			n = file_read(fileobj, bounce, chunk);
+			lock_release(&filesys_lock);
+		}
+		if (!copy_to_user((uint8_t *)buffer + read_count, bounce, n))
+		{
+			palloc_free_page(bounce);
+			exit(-1);
+		}
+		read_count += n;
+		if ((unsigned)n < chunk)
+		{
+			break;
+		}
 	}
+	palloc_free_page(bounce);
 	return read_count;
 }
 
 /* 열린파일의 데이터를 기록하는 시스템콜 함수 */
 int write(int fd, const void *buffer, unsigned size)
 {
-	check_address(buffer);
-
-	int write_count;
 	struct file *fileobj = process_get_file(fd);
-	
-	if (fileobj == NULL)
+	uint8_t *bounce;
+	unsigned write_count = 0;
+
+	if (fileobj == NULL || fileobj == STDIN)
 	{
 		return -1;
 	}
 
-	if (fileobj == STDOUT)
+	if (size == 0)
 	{
-		putbuf(buffer, size);
-		write_count = size;
+		return 0;
 	}
-	else if (fileobj == STDIN)
+
+	bounce = palloc_get_page(0);
+	if (bounce == NULL)
 	{
 		return -1;
 	}
-	else
+	while (write_count < size)
 	{
-		lock_acquire(&filesys_lock);
-		write_count = file_write(fileobj, buffer, size);
-		lock_release(&filesys_lock);
+		unsigned chunk = size - write_count < PGSIZE ? size - write_count : PGSIZE;
+		int n;
+
+		if (!copy_from_user(bounce, (const uint8_t *)buffer + write_count, chunk))
+		{
+			palloc_free_page(bounce);
+			exit(-1);
+		}
+		if (fileobj == STDOUT)
+		{
+			putbuf((const char *)bounce, chunk);
+			n = chunk;
+		}
+		else
+		{
+			lock_acquire(&filesys_lock);
+			n = file_write(fileobj, bounce, chunk);
+			lock_release(&filesys_lock);
+		}
+		write_count += n;
+		if ((unsigned)n < chunk)
+		{
+			break;
+		}
 	}
+	palloc_free_page(bounce);
 	return write_count;
 }
 
@@ -356,7 +471,7 @@ int write(int fd, const void *buffer, unsigned size)
 void seek(int fd, unsigned position)
 {
 	struct file *fileobj = process_get_file(fd);
-	if (fd < 2)
+	if (fileobj == NULL || process_is_std_file(fileobj))
 	{
 		return;
 	}
@@ -367,14 +482,10 @@ void seek(int fd, unsigned position)
 /* 열린 파일의 위치(offset)를 알려주는 시스템콜 함수*/
 unsigned tell(int fd)
 {
-	if (fd < 2)
-	{
-		return;
-	}
 	struct file *fileobj = process_get_file(fd);
-	if (fd < 2)
+	if (fileobj == NULL || process_is_std_file(fileobj))
 	{
-		return;
+		return -1;
 	}
 
 	return file_tell(fileobj);
@@ -383,8 +494,6 @@ unsigned tell(int fd)
 /* 열린 파일을 닫는 시스템 콜 함수*/
 void close(int fd)
 {
-	if (fd <= 1)
-		return;
 	struct file *fileobj = process_get_file(fd);
 
 	if (fileobj == NULL)
@@ -392,6 +501,40 @@ void close(int fd)
 		return;
 	}
 	process_close_file(fd);
+
+	/* 표준 입출력은 실제 파일 객체가 없으므로 fd만 비운다. */
+	if (process_is_std_file(fileobj))
+		return;
+
+	/* 페이지 폴트로 종료되는 경우처럼 이미 락을 쥐고 있을 수 있다. */
+	bool held = lock_held_by_current_thread(&filesys_lock);
+	if (!held)
+		lock_acquire(&filesys_lock);
+	file_close(fileobj);
+	if (!held)
+		lock_release(&filesys_lock);
+}
+
+/* OLDFD를 NEWFD로 복제하는 시스템콜 함수.
+   NEWFD가 열려 있으면 먼저 닫고, 두 fd는 파일 위치까지 같은 파일 객체를 공유한다. */
+int dup2(int oldfd, int newfd)
+{
+	struct thread *curr = thread_current();
+	struct file *fileobj = process_get_file(oldfd);
+
+	if (fileobj == NULL || newfd < 0)
+		return -1;
+	if (oldfd == newfd)
+		return newfd;
+	if (!process_fdt_reserve(curr, newfd + 1))
+		return -1;
+
+	close(newfd);
+	if (!process_is_std_file(fileobj))
+		file_share(fileobj);
+	curr->fdt[newfd] = fileobj;
+	curr->fd_map[newfd / FD_MAP_BITS] |= 1ULL << (newfd % FD_MAP_BITS);
+	return newfd;
 }
 
 /* 자식스레드를 복제하는 함수 */
@@ -406,34 +549,260 @@ int wait(tid_t pid)
 	return process_wait(pid);
 }
 
+/* 사용자 문자열 USTR을 *BUF부터 END 전까지의 공간에 복사하고 *BUF를 그 뒤로 옮기는 함수.
+   복사한 문자열을 DST에 넣는다. 잘못된 주소면 -1, 공간이 모자라면 0, 성공하면 1을 반환한다. */
+static int copy_in_arg(char **buf, char *end, const char *ustr, char **dst)
+{
+	int len;
+
+	if (*buf == end)
+		return 0;
+	len = strncpy_from_user(*buf, ustr, end - *buf);
+	if (len < 0)
+		return -1;
+	if (*buf + len == end)
+		return 0;
+	*dst = *buf;
+	*buf += len + 1;
+	return 1;
+}
+
+/* PATH 프로그램을 ARGV 인자로 실행하는 자식 프로세스를 만드는 시스템콜 함수.
+   fork 뒤에 exec하는 것과 같지만 부모의 메모리를 복제하지 않는다.
+   FDS가 NULL이면 부모의 fd를 모두 물려주고, 아니면 자식의 fd i는 부모의 fd FDS[i]가 되며
+   (-1이면 닫힘) 나머지 fd는 닫혀 있다. 자식의 pid를 반환하고, 실패하면 -1을 반환한다. */
+tid_t spawn(const char *path, char *const argv[], const int *fds, int fd_cnt)
+{
+	struct spawn_args *args = palloc_get_page(0);
+	if (args == NULL)
+		return -1;
+
+	/* 문자열은 페이지에서 구조체 뒤의 남은 공간에 차례로 복사한다. */
+	char *buf = (char *)(args + 1);
+	char *end = (char *)args + PGSIZE;
+	tid_t tid = -1;
+	int r;
+
+	if ((r = copy_in_arg(&buf, end, path, &args->path)) <= 0)
+		goto done;
+
+	args->argc = 0;
+	while (argv != NULL)
+	{
+		char *uarg;
+		if (!copy_from_user(&uarg, &argv[args->argc], sizeof uarg))
+		{
+			r = -1;
+			goto done;
+		}
+		if (uarg == NULL)
+			break;
+		if (args->argc == SPAWN_ARGC_MAX)
+			goto done;
+		if ((r = copy_in_arg(&buf, end, uarg, &args->argv[args->argc])) <= 0)
+			goto done;
+		args->argc++;
+	}
+	/* 인자가 없으면 실행할 파일 이름을 argv[0]으로 쓴다. */
+	if (args->argc == 0)
+		args->argv[args->argc++] = args->path;
+	args->argv[args->argc] = NULL;
+
+	args->fds = NULL;
+	args->fd_cnt = 0;
+	if (fds != NULL)
+	{
+		if (fd_cnt < 0 || fd_cnt > SPAWN_FD_MAX)
+			goto done;
+		if (!copy_from_user(args->fd_buf, fds, fd_cnt * sizeof *fds))
+		{
+			r = -1;
+			goto done;
+		}
+		args->fds = args->fd_buf;
+		args->fd_cnt = fd_cnt;
+	}
+
+	tid = process_spawn(args);
+done:
+	palloc_free_page(args);
+	if (r < 0)
+		exit(-1);
+	return tid;
+}
+
+#ifndef VM
+/* 사용자 영역에 매핑된 페이지의 크기를 AUX에 더한다. */
+static bool count_user_page(uint64_t *pte, void *va, void *aux)
+{
+	struct memstat *ms = aux;
+
+	if (is_user_vaddr(va))
+	{
+		size_t size = is_huge_pte(pte) ? HUGE_PGSIZE : PGSIZE;
+		ms->rss += size;
+		ms->pss += size;
+	}
+	return true;
+}
+#endif
+
+/* 현재 프로세스의 RSS와 PSS를 MS에 기록하는 시스템콜 함수 */
+int memstat(struct memstat *ms)
+{
+	struct memstat stat;
+
+#ifdef VM
+	vm_memstat(&thread_current()->spt, &stat);
+#else
+	/* VM이 없으면 프레임을 공유하지 않으므로 PSS는 RSS와 같다. */
+	stat.rss = stat.pss = 0;
+	pml4_for_each(thread_current()->pml4, count_user_page, &stat);
+#endif
+	if (!copy_to_user(ms, &stat, sizeof stat))
+		exit(-1);
+	return 0;
+}
+
+/* WHO가 RUSAGE_SELF이면 현재 프로세스, RUSAGE_CHILDREN이면 wait()으로 거둔
+   자식들의 자원 사용량을 USAGE에 채우는 시스템콜 함수. */
+int getrusage(int who, struct rusage *usage)
+{
+	struct thread *curr = thread_current();
+	struct rusage ru;
+
+	if (who == RUSAGE_SELF)
+		ru = curr->rusage;
+	else if (who == RUSAGE_CHILDREN)
+		ru = curr->child_rusage;
+	else
+		return -1;
+	if (!copy_to_user(usage, &ru, sizeof ru))
+		exit(-1);
+	return 0;
+}
+
+/* RING에 쌓인 시스템콜을 차례로 실행하고, 실행한 개수를 반환하는 시스템콜 함수.
+   완료 큐가 가득 차면 남은 제출은 다음 호출로 미룬다. */
+int sysring_enter(struct sysring *ring)
+{
+	const uint32_t mask = SYSRING_SIZE - 1;
+	uint32_t head, cq_tail;
+	int done = 0;
+
+	/* 링 전체를 한 번만 확인하고, 이후로는 직접 읽고 쓴다. */
+	check_buffer(ring, sizeof *ring, true);
+
+	head = ring->sq_head;
+	cq_tail = ring->cq_tail;
+	while (head != ring->sq_tail && cq_tail - ring->cq_head < SYSRING_SIZE)
+	{
+		struct sysring_sqe sqe = ring->sq[head & mask];
+		const struct syscall_desc *d = syscall_lookup(sqe.nr);
+		uint64_t args[6] = {sqe.args[0], sqe.args[1], sqe.args[2]};
+		struct sysring_cqe *cqe = &ring->cq[cq_tail & mask];
+
+		cqe->user_data = sqe.user_data;
+		cqe->res = d != NULL && d->batch ? (int64_t)syscall_call(d, args, NULL) : -1;
+
+		/* 제출마다 완료를 바로 알려, 중간에 종료되어도 링이 어긋나지 않게 한다. */
+		ring->sq_head = ++head;
+		ring->cq_tail = ++cq_tail;
+		done++;
+	}
+	return done;
+}
+
 /*  현재 스레드의 fdt에 주어진 파일을 추가하고, 추가된 파일의 식별자를 반환하는 함수*/
 int process_add_file(struct file *f)
 {
 	struct thread *curr = thread_current();
-	struct file **fdt = curr->fdt;
+	int words = FD_MAP_WORDS(curr->fd_cap);
+	int fd = curr->fd_cap;
 
-	while (curr->next_fd < FDCOUNT_LIMIT && fdt[curr->next_fd])
+	/* 비트맵에서 0인 비트를 워드 단위로 찾아 가장 작은 빈 fd를 고른다. */
+	for (int w = 0; w < words; w++)
 	{
-		curr->next_fd++;
+		if (~curr->fd_map[w] != 0)
+		{
+			fd = w * FD_MAP_BITS + __builtin_ctzll(~curr->fd_map[w]);
+			break;
+		}
 	}
 
-	if (curr->next_fd >= FDCOUNT_LIMIT)
-		{
+	if (fd >= curr->fd_cap && !process_fdt_reserve(curr, fd + 1))
+		return -1;
+
+	curr->fdt[fd] = f;
+	curr->fd_map[fd / FD_MAP_BITS] |= 1ULL << (fd % FD_MAP_BITS);
+	return fd;
+}
+
+/* T의 fdt가 CNT개 이상의 칸을 갖도록 두 배씩 늘리는 함수.
+   FDCOUNT_LIMIT를 넘거나 메모리가 없으면 false를 반환한다. */
+bool process_fdt_reserve(struct thread *t, int cnt)
+{
+	int cap = t->fd_cap;
+
+	if (cnt <= cap)
+		return true;
+	if (cnt > FDCOUNT_LIMIT)
+		return false;
+	while (cap < cnt)
+		cap = cap * 2 < FDCOUNT_LIMIT ? cap * 2 : FDCOUNT_LIMIT;
+
+	struct file **fdt = calloc(cap, sizeof *fdt);
+	uint64_t *fd_map = calloc(FD_MAP_WORDS(cap), sizeof *fd_map);
+	if (fdt == NULL || fd_map == NULL)
+	{
+		free(fdt);
+		free(fd_map);
+		return false;
+	}
+	memcpy(fdt, t->fdt, t->fd_cap * sizeof *fdt);
+	memcpy(fd_map, t->fd_map, FD_MAP_WORDS(t->fd_cap) * sizeof *fd_map);
+	free(t->fdt);
+	free(t->fd_map);
+	t->fdt = fdt;
+	t->fd_map = fd_map;
+	t->fd_cap = cap;
+	return true;
+}
+
+/* T에서 사용 중인 fd 중 FD 이상인 가장 작은 것을 반환하는 함수.
+   없으면 -1을 반환한다. 빈 칸은 비트맵 워드 단위로 건너뛴다. */
+int process_next_fd(struct thread *t, int fd)
+{
+	int words = FD_MAP_WORDS(t->fd_cap);
+	int w = fd / FD_MAP_BITS;
+
+	if (fd < 0 || fd >= t->fd_cap)
+		return -1;
+
+	uint64_t bits = t->fd_map[w] & (~0ULL << (fd % FD_MAP_BITS));
+	while (bits == 0)
+	{
+		if (++w >= words)
 			return -1;
-		}
+		bits = t->fd_map[w];
+	}
+	return w * FD_MAP_BITS + __builtin_ctzll(bits);
+}
 
-	fdt[curr->next_fd] = f;
-	return curr->next_fd;
+/* F가 표준 입출력을 나타내는 가짜 파일 객체인지 확인하는 함수 */
+bool process_is_std_file(struct file *f)
+{
+	return f == (struct file *)(uintptr_t)STDIN || f == (struct file *)(uintptr_t)STDOUT;
 }
 
 /* 주어진 파일 식별자에 해당하는 파일 포인터를 반환하는 함수*/
 struct file *process_get_file(int fd)
 {
-	if (fd < 0 || fd >= FDCOUNT_LIMIT || fd == NULL)
+	struct thread *curr = thread_current();
+	if (fd < 0 || fd >= curr->fd_cap)
 	{
 		return NULL;
 	}
-	struct thread *curr = thread_current();
 	return curr->fdt[fd];
 }
 
@@ -441,8 +810,9 @@ struct file *process_get_file(int fd)
 void process_close_file(int fd)
 {
 	struct thread *curr = thread_current();
-	if (fd < 0 || fd >= FDCOUNT_LIMIT)
+	if (fd < 0 || fd >= curr->fd_cap)
 		return;
 
 	curr->fdt[fd] = NULL;
-}
\ No newline at end of file
+	curr->fd_map[fd / FD_MAP_BITS] &= ~(1ULL << (fd % FD_MAP_BITS));
+}
@@ -1,7 +1,14 @@
 /* anon.c: Implementation of page for non-disk image (a.k.a. anonymous page). */
 
+#include <bitmap.h>
 #include "vm/vm.h"
+#include "vm/zswap.h"
 #include "devices/disk.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Number of disk sectors per swap slot. */
+#define SECTORS_PER_SLOT (PGSIZE / DISK_SECTOR_SIZE)
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -17,11 +24,20 @@ static const struct page_operations anon_ops = {
 	.type = VM_ANON,
 };
 
+/* Swap slots in use, and the lock that protects the bitmap. */
+static struct bitmap *swap_slots;
+static struct lock swap_lock;
+
 /* Initialize the data for anonymous pages */
 void
 vm_anon_init (void) {
-	/* TODO: Set up the swap_disk. */
-	swap_disk = NULL;
+	swap_disk = disk_get (1, 1);
+	swap_slots = bitmap_create (swap_disk != NULL
+			? disk_size (swap_disk) / SECTORS_PER_SLOT : 0);
+	if (swap_slots == NULL)
+		PANIC ("swap slot table creation failed");
+	lock_init (&swap_lock);
+	zswap_init ();
 }
 
 /* Initialize the file mapping */
@@ -31,22 +47,97 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 	page->operations = &anon_ops;
 
 	struct anon_page *anon_page = &page->anon;
+	anon_page->where = ANON_RESIDENT;
+	anon_page->swap_slot = BITMAP_ERROR;
+	return true;
+}
+
+/* Releases the swap slot of ANON_PAGE, if any. */
+static void
+release_slot (struct anon_page *anon_page) {
+	if (anon_page->swap_slot != BITMAP_ERROR) {
+		lock_acquire (&swap_lock);
+		bitmap_reset (swap_slots, anon_page->swap_slot);
+		lock_release (&swap_lock);
+		anon_page->swap_slot = BITMAP_ERROR;
+	}
 }
 
-/* Swap in the page by read contents from the swap disk. */
+/* Swap in the page by read contents from the swap disk, or from the
+ * compressed pool.  A swap slot is kept, so that a page that stays
+ * clean can be evicted again without writing it. */
 static bool
 anon_swap_in (struct page *page, void *kva) {
 	struct anon_page *anon_page = &page->anon;
+	size_t i;
+
+	switch (anon_page->where) {
+		case ANON_FILLED:
+			zswap_fill (kva, anon_page->fill);
+			break;
+		case ANON_ZSWAP:
+			zswap_load (anon_page->zdata, anon_page->zsize, kva);
+			zswap_free (anon_page->zdata, anon_page->zsize);
+			break;
+		case ANON_DISK:
+			for (i = 0; i < SECTORS_PER_SLOT; i++)
+				disk_read (swap_disk, anon_page->swap_slot * SECTORS_PER_SLOT + i,
+						(uint8_t *) kva + i * DISK_SECTOR_SIZE);
+			break;
+		default:
+			return false;
+	}
+	anon_page->where = ANON_RESIDENT;
+	return true;
 }
 
-/* Swap out the page by writing contents to the swap disk. */
+/* Swap out the page by writing contents to the swap disk.  A page
+ * filled with one word, or one that compresses well while the pool
+ * has room, is kept in memory instead. */
 static bool
 anon_swap_out (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+	void *kva = page->frame->kva;
+	size_t i;
+
+	if (anon_page->swap_slot != BITMAP_ERROR
+			&& !vm_frame_is_dirty (page->frame)) {
+		anon_page->where = ANON_DISK;
+		return true;
+	}
+	if (zswap_same_filled (kva, &anon_page->fill)) {
+		release_slot (anon_page);
+		anon_page->where = ANON_FILLED;
+		return true;
+	}
+	anon_page->zdata = zswap_store (kva, &anon_page->zsize);
+	if (anon_page->zdata != NULL) {
+		release_slot (anon_page);
+		anon_page->where = ANON_ZSWAP;
+		return true;
+	}
+
+	if (anon_page->swap_slot == BITMAP_ERROR) {
+		lock_acquire (&swap_lock);
+		anon_page->swap_slot = bitmap_scan_and_flip (swap_slots, 0, 1, false);
+		lock_release (&swap_lock);
+		if (anon_page->swap_slot == BITMAP_ERROR)
+			return false;
+	}
+	for (i = 0; i < SECTORS_PER_SLOT; i++)
+		disk_write (swap_disk, anon_page->swap_slot * SECTORS_PER_SLOT + i,
+				(uint8_t *) kva + i * DISK_SECTOR_SIZE);
+	zswap_count_disk_write ();
+	anon_page->where = ANON_DISK;
+	return true;
 }
 
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void
 anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+
+	if (anon_page->where == ANON_ZSWAP)
+		zswap_free (anon_page->zdata, anon_page->zsize);
+	release_slot (anon_page);
 }
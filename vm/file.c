@@ -1,6 +1,9 @@
 /* file.c: Implementation of memory backed file object (mmaped object). */
 
+#include <string.h>
 #include "vm/vm.h"
+#include "threads/malloc.h"
+#include "userprog/syscall.h"
 
 static bool file_backed_swap_in (struct page *page, void *kva);
 static bool file_backed_swap_out (struct page *page);
@@ -19,31 +22,63 @@ void
 vm_file_init (void) {
 }
 
-/* Initialize the file backed page */
+/* Initialize the file backed page from the lazy_load_aux that was
+ * passed as aux of the uninit page, which is consumed, and reads its
+ * contents into KVA.  If KVA is a null pointer, only PAGE is set up,
+ * for a page that is about to map a frame that already holds its
+ * contents. */
 bool
-file_backed_initializer (struct page *page, enum vm_type type, void *kva) {
+file_backed_initializer (struct page *page, enum vm_type type UNUSED,
+		void *kva) {
+	struct lazy_load_aux *aux = page->uninit.aux;
+
 	/* Set up the handler */
 	page->operations = &file_ops;
 
 	struct file_page *file_page = &page->file;
+	file_page->file = aux->file;
+	file_page->ofs = aux->ofs;
+	file_page->read_bytes = aux->read_bytes;
+	file_page->zero_bytes = aux->zero_bytes;
+	free (aux);
+	return kva == NULL || file_backed_swap_in (page, kva);
 }
 
 /* Swap in the page by read contents from the file. */
 static bool
 file_backed_swap_in (struct page *page, void *kva) {
-	struct file_page *file_page UNUSED = &page->file;
+	struct file_page *file_page = &page->file;
+	bool held = lock_held_by_current_thread (&filesys_lock);
+	bool success;
+
+	/* Faults may hit in the middle of a syscall that already holds
+	 * the file system lock. */
+	if (!held)
+		lock_acquire (&filesys_lock);
+	success = file_read_at (file_page->file, kva, file_page->read_bytes,
+			file_page->ofs) == (int) file_page->read_bytes;
+	if (!held)
+		lock_release (&filesys_lock);
+
+	if (success)
+		memset ((uint8_t *) kva + file_page->read_bytes, 0,
+				file_page->zero_bytes);
+	return success;
 }
 
-/* Swap out the page by writeback contents to the file. */
+/* Swap out the page by writeback contents to the file.  File pages
+ * are only used for read-only mappings so far, which are never dirty:
+ * the contents are simply read again on the next fault. */
 static bool
 file_backed_swap_out (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+	ASSERT (!page->writable);
+	return true;
 }
 
 /* Destory the file backed page. PAGE will be freed by the caller. */
 static void
-file_backed_destroy (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+file_backed_destroy (struct page *page UNUSED) {
+	/* The file belongs to the page's region. */
 }
 
 /* Do the mmap */
@@ -1,9 +1,39 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
+#include <string.h>
+#include <memstat.h>
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "filesys/file.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
 
+/* Maximum fault-around window, in pages.  1 disables fault-around.
+ * Set by the "-fa=PAGES" kernel command line option. */
+size_t vm_fault_around_pages = FAULT_AROUND_DEFAULT;
+
+/* Caches of struct page and struct frame. */
+static struct kmem_cache *page_cache;
+static struct kmem_cache *frame_cache;
+static kmem_ctor_func frame_ctor;
+
+/* Frame table: every frame that is mapped by some page, in clock
+ * order.  The lock also protects the reverse maps of the frames and
+ * page->frame of every page. */
+static struct list frame_table;
+static struct list_elem *clock_hand;
+static struct lock frame_lock;
+
+/* Text cache: frames holding shared read-only file pages, keyed by
+ * (inode, offset, read bytes).  Protected by the frame table lock. */
+static struct hash text_cache;
+static hash_hash_func text_hash;
+static hash_less_func text_less;
+
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
 void
@@ -15,7 +45,13 @@ vm_init (void) {
 #endif
 	register_inspect_intr ();
 	/* DO NOT MODIFY UPPER LINES. */
-	/* TODO: Your code goes here. */
+	page_cache = kmem_cache_create ("page", sizeof (struct page), NULL);
+	frame_cache = kmem_cache_create ("frame", sizeof (struct frame),
+			frame_ctor);
+	list_init (&frame_table);
+	clock_hand = NULL;
+	lock_init (&frame_lock);
+	hash_init (&text_cache, text_hash, text_less, NULL);
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -36,6 +72,14 @@ page_get_type (struct page *page) {
 static struct frame *vm_get_victim (void);
 static bool vm_do_claim_page (struct page *page);
 static struct frame *vm_evict_frame (void);
+static struct frame *vm_alloc_frame (bool zero);
+static bool page_wants_zero (const struct page *page);
+static void vm_release_frame (struct frame *frame);
+static void vm_free_frame (struct page *page);
+static bool vm_map_frame (struct page *page, struct frame *frame);
+static bool vm_share_text_page (struct page *page);
+static void vm_fault_around (struct supplemental_page_table *spt,
+		struct page *page);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
@@ -50,11 +94,31 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 
 	/* Check wheter the upage is already occupied or not. */
 	if (spt_find_page (spt, upage) == NULL) {
-		/* TODO: Create the page, fetch the initialier according to the VM type,
-		 * TODO: and then create "uninit" page struct by calling uninit_new. You
-		 * TODO: should modify the field after calling the uninit_new. */
-
-		/* TODO: Insert the page into the spt. */
+		bool (*initializer) (struct page *, enum vm_type, void *);
+		struct page *page = kmem_cache_alloc (page_cache);
+		if (page == NULL)
+			goto err;
+
+		switch (VM_TYPE (type)) {
+			case VM_ANON:
+				initializer = anon_initializer;
+				break;
+			case VM_FILE:
+				initializer = file_backed_initializer;
+				break;
+			default:
+				kmem_cache_free (page_cache, page);
+				goto err;
+		}
+		uninit_new (page, upage, init, type, aux, initializer);
+		page->writable = writable;
+		page->pml4 = thread_current ()->pml4;
+
+		if (!spt_insert_page (spt, page)) {
+			kmem_cache_free (page_cache, page);
+			goto err;
+		}
+		return true;
 	}
 err:
 	return false;
@@ -62,62 +126,306 @@ err:
 
 /* Find VA from spt and return page. On error, return NULL. */
 struct page *
-spt_find_page (struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
-	struct page *page = NULL;
-	/* TODO: Fill this function. */
+spt_find_page (struct supplemental_page_table *spt, void *va) {
+	struct page key;
+	struct hash_elem *e;
 
-	return page;
+	key.va = pg_round_down (va);
+	e = hash_find (&spt->pages, &key.spt_elem);
+	return e != NULL ? hash_entry (e, struct page, spt_elem) : NULL;
 }
 
 /* Insert PAGE into spt with validation. */
 bool
-spt_insert_page (struct supplemental_page_table *spt UNUSED,
-		struct page *page UNUSED) {
-	int succ = false;
-	/* TODO: Fill this function. */
-
-	return succ;
+spt_insert_page (struct supplemental_page_table *spt,
+		struct page *page) {
+	return hash_insert (&spt->pages, &page->spt_elem) == NULL;
 }
 
 void
 spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
+	hash_delete (&spt->pages, &page->spt_elem);
+	vm_free_frame (page);
 	vm_dealloc_page (page);
+}
+
+/* Registers the file-backed region [START, END) of SPT, backed by
+ * its own handle on FILE.  Returns the new region, or a null pointer
+ * if memory or the file handle cannot be obtained. */
+struct vm_region *
+vm_region_create (struct supplemental_page_table *spt,
+		void *start, void *end, struct file *file) {
+	struct vm_region *r;
+
+	ASSERT (pg_ofs (start) == 0 && pg_ofs (end) == 0);
+
+	r = malloc (sizeof *r);
+	if (r == NULL)
+		return NULL;
+	r->file = file_reopen (file);
+	if (r->file == NULL) {
+		free (r);
+		return NULL;
+	}
+	r->start = start;
+	r->end = end;
+	r->fa_window = vm_fault_around_pages < 4 ? vm_fault_around_pages : 4;
+	r->fa_start = r->fa_end = NULL;
+	r->fa_prefetched = 0;
+	list_push_back (&spt->regions, &r->elem);
+	return r;
+}
+
+/* Returns the region of SPT that contains VA, or a null pointer. */
+struct vm_region *
+vm_region_find (struct supplemental_page_table *spt, const void *va) {
+	struct list_elem *e;
+
+	for (e = list_begin (&spt->regions); e != list_end (&spt->regions);
+			e = list_next (e)) {
+		struct vm_region *r = list_entry (e, struct vm_region, elem);
+		if (r->start <= va && va < r->end)
+			return r;
+	}
+	return NULL;
+}
+
+/* Reverse map.
+ *
+ * A frame keeps the list of pages that map it.  Each page belongs to
+ * one process and knows that process's page map, so everything that
+ * needs the hardware view of a frame looks at its mappers' PTEs
+ * instead of walking every page table in the system. */
+
+/* Adds PAGE, which is mapped to FRAME in PAGE->pml4, to FRAME's
+ * mappers.  Called with the frame table lock held. */
+static void
+rmap_add (struct frame *frame, struct page *page) {
+	if (frame->mapcount++ == 0) {
+		frame->page = page;
+		list_push_back (&frame_table, &frame->ft_elem);
+	}
+	list_push_back (&frame->mappers, &page->rmap_elem);
+}
+
+/* Removes PAGE from FRAME's mappers.  Returns true if that was the
+ * last mapper, in which case FRAME has left the frame table.
+ * Called with the frame table lock held. */
+static bool
+rmap_remove (struct frame *frame, struct page *page) {
+	list_remove (&page->rmap_elem);
+	if (--frame->mapcount > 0) {
+		if (frame->page == page)
+			frame->page = list_entry (list_front (&frame->mappers),
+					struct page, rmap_elem);
+		return false;
+	}
+	if (clock_hand == &frame->ft_elem)
+		clock_hand = list_next (clock_hand);
+	list_remove (&frame->ft_elem);
+	if (frame->inode != NULL) {
+		hash_delete (&text_cache, &frame->tc_elem);
+		frame->inode = NULL;
+	}
+	frame->page = NULL;
 	return true;
 }
 
-/* Get the struct frame, that will be evicted. */
+/* Returns true if FRAME has been written through any of its
+ * mappings since they were installed.  The dirty bits survive the
+ * unmapping done by eviction, so this is also valid in swap_out. */
+bool
+vm_frame_is_dirty (struct frame *frame) {
+	struct list_elem *e;
+
+	for (e = list_begin (&frame->mappers); e != list_end (&frame->mappers);
+			e = list_next (e)) {
+		struct page *p = list_entry (e, struct page, rmap_elem);
+		if (pml4_is_dirty (p->pml4, p->va))
+			return true;
+	}
+	return false;
+}
+
+/* Returns true if FRAME has been accessed through any of its
+ * mappings since the last call, and clears the accessed bits. */
+static bool
+frame_test_and_clear_accessed (struct frame *frame) {
+	struct list_elem *e;
+	bool accessed = false;
+
+	for (e = list_begin (&frame->mappers); e != list_end (&frame->mappers);
+			e = list_next (e)) {
+		struct page *p = list_entry (e, struct page, rmap_elem);
+		if (pml4_is_accessed (p->pml4, p->va)) {
+			pml4_set_accessed (p->pml4, p->va, false);
+			accessed = true;
+		}
+	}
+	return accessed;
+}
+
+/* Get the struct frame, that will be evicted.  This is the second
+ * chance clock: frames accessed since the hand last passed them are
+ * skipped once.  Called with the frame table lock held. */
 static struct frame *
 vm_get_victim (void) {
-	struct frame *victim = NULL;
-	 /* TODO: The policy for eviction is up to you. */
+	size_t tries = 2 * list_size (&frame_table);
 
-	return victim;
+	while (tries-- > 0) {
+		struct frame *frame;
+
+		if (clock_hand == NULL || clock_hand == list_end (&frame_table))
+			clock_hand = list_begin (&frame_table);
+		frame = list_entry (clock_hand, struct frame, ft_elem);
+		clock_hand = list_next (clock_hand);
+		if (!frame_test_and_clear_accessed (frame))
+			return frame;
+	}
+	return NULL;
+}
+
+/* Unmaps VICTIM from all of its mappers and swaps each of them out.
+ * If a mapper cannot be swapped out, the mappings are restored and
+ * false is returned; swap_out never changes the frame's contents,
+ * so the frame is still good in that case. */
+static bool
+frame_swap_out (struct frame *victim) {
+	struct list_elem *e;
+
+	for (e = list_begin (&victim->mappers); e != list_end (&victim->mappers);
+			e = list_next (e)) {
+		struct page *p = list_entry (e, struct page, rmap_elem);
+		pml4_clear_page (p->pml4, p->va);
+	}
+	for (e = list_begin (&victim->mappers); e != list_end (&victim->mappers);
+			e = list_next (e)) {
+		struct page *p = list_entry (e, struct page, rmap_elem);
+		if (!swap_out (p)) {
+			for (e = list_begin (&victim->mappers);
+					e != list_end (&victim->mappers); e = list_next (e)) {
+				p = list_entry (e, struct page, rmap_elem);
+				pml4_set_page (p->pml4, p->va, victim->kva, p->writable);
+			}
+			return false;
+		}
+	}
+	while (!list_empty (&victim->mappers)) {
+		struct page *p = list_entry (list_front (&victim->mappers),
+				struct page, rmap_elem);
+		rmap_remove (victim, p);
+		p->frame = NULL;
+	}
+	return true;
 }
 
 /* Evict one page and return the corresponding frame.
  * Return NULL on error.*/
 static struct frame *
 vm_evict_frame (void) {
-	struct frame *victim UNUSED = vm_get_victim ();
-	/* TODO: swap out the victim and return the evicted frame. */
+	struct frame *victim;
 
-	return NULL;
+	lock_acquire (&frame_lock);
+	victim = vm_get_victim ();
+	if (victim != NULL && !frame_swap_out (victim))
+		victim = NULL;
+	lock_release (&frame_lock);
+	return victim;
+}
+
+/* Brings a struct frame of the cache into the state of a frame
+ * without mappers, which is also the state it is freed in. */
+static void
+frame_ctor (void *frame_) {
+	struct frame *frame = frame_;
+
+	frame->page = NULL;
+	list_init (&frame->mappers);
+	frame->mapcount = 0;
+	frame->inode = NULL;
+}
+
+/* Returns a frame backed by a free page of the user pool, zeroed if
+ * ZERO, or a null pointer if the pool is exhausted.  Never evicts. */
+static struct frame *
+vm_alloc_frame (bool zero) {
+	struct frame *frame;
+	void *kva = palloc_get_page (PAL_USER | (zero ? PAL_ZERO : 0));
+
+	if (kva == NULL)
+		return NULL;
+	frame = kmem_cache_alloc (frame_cache);
+	if (frame == NULL) {
+		palloc_free_page (kva);
+		return NULL;
+	}
+	frame->kva = kva;
+	return frame;
+}
+
+/* Releases FRAME, which has no mappers. */
+static void
+vm_release_frame (struct frame *frame) {
+	ASSERT (frame->mapcount == 0);
+
+	palloc_free_page (frame->kva);
+	kmem_cache_free (frame_cache, frame);
 }
 
 /* palloc() and get frame. If there is no available page, evict the page
- * and return it. This always return valid address. That is, if the user pool
- * memory is full, this function evicts the frame to get the available memory
- * space.*/
+ * and return it.  The frame is zeroed if ZERO; otherwise it may hold
+ * a previous owner's data.  Returns a null pointer only if the user
+ * pool is full and no frame can be evicted, e.g. because swap is full. */
 static struct frame *
-vm_get_frame (void) {
-	struct frame *frame = NULL;
-	/* TODO: Fill this function. */
+vm_get_frame (bool zero) {
+	struct frame *frame = vm_alloc_frame (zero);
 
-	ASSERT (frame != NULL);
-	ASSERT (frame->page == NULL);
+	if (frame == NULL) {
+		frame = vm_evict_frame ();
+		if (frame != NULL && zero)
+			memset (frame->kva, 0, PGSIZE);
+	}
+
+	ASSERT (frame == NULL || frame->page == NULL);
 	return frame;
 }
 
+/* Unmaps PAGE and releases its frame, unless another page still
+ * maps it. */
+static void
+vm_free_frame (struct page *page) {
+	struct frame *frame;
+
+	lock_acquire (&frame_lock);
+	frame = page->frame;
+	if (frame != NULL) {
+		pml4_clear_page (page->pml4, page->va);
+		if (rmap_remove (frame, page))
+			vm_release_frame (frame);
+		page->frame = NULL;
+	}
+	lock_release (&frame_lock);
+}
+
+/* Stores the resident and proportional set sizes of SPT in MS. */
+void
+vm_memstat (struct supplemental_page_table *spt, struct memstat *ms) {
+	struct hash_iterator i;
+
+	ms->rss = ms->pss = 0;
+	lock_acquire (&frame_lock);
+	hash_first (&i, &spt->pages);
+	while (hash_next (&i)) {
+		struct page *page = hash_entry (hash_cur (&i), struct page, spt_elem);
+
+		if (page->frame != NULL) {
+			ms->rss += PGSIZE;
+			ms->pss += PGSIZE / page->frame->mapcount;
+		}
+	}
+	lock_release (&frame_lock);
+}
+
 /* Growing the stack. */
 static void
 vm_stack_growth (void *addr UNUSED) {
@@ -126,18 +434,31 @@ vm_stack_growth (void *addr UNUSED) {
 /* Handle the fault on write_protected page */
 static bool
 vm_handle_wp (struct page *page UNUSED) {
+	return false;
 }
 
 /* Return true on success */
 bool
-vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
-		bool user UNUSED, bool write UNUSED, bool not_present UNUSED) {
-	struct supplemental_page_table *spt UNUSED = &thread_current ()->spt;
+vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr,
+		bool user UNUSED, bool write, bool not_present) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
 	struct page *page = NULL;
-	/* TODO: Validate the fault */
-	/* TODO: Your code goes here */
 
-	return vm_do_claim_page (page);
+	if (addr == NULL || is_kernel_vaddr (addr))
+		return false;
+
+	page = spt_find_page (spt, addr);
+	if (page == NULL)
+		return false;
+	if (!not_present)
+		return vm_handle_wp (page);
+	if (write && !page->writable)
+		return false;
+
+	if (!vm_do_claim_page (page))
+		return false;
+	vm_fault_around (spt, page);
+	return true;
 }
 
 /* Free the page.
@@ -148,43 +469,415 @@ vm_dealloc_page (struct page *page) {
 	free (page);
 }
 
+/* Shared text.
+ *
+ * Read-only pages of a file, such as the text of an executable, are
+ * the same in every process that maps them.  The first process to
+ * fault on such a page reads it into a frame that is entered into
+ * the text cache; every later fault on the same page of the same
+ * inode maps that frame instead, and the reverse map keeps track of
+ * the sharers.  The frame leaves the cache with its last mapper. */
+
+/* Stores in KEY the text cache key of PAGE and returns true, or
+ * returns false if PAGE is not a shareable page. */
+static bool
+page_text_key (struct page *page, struct frame *key) {
+	struct file *file;
+
+	if (page->writable)
+		return false;
+	switch (VM_TYPE (page->operations->type)) {
+		case VM_UNINIT: {
+			struct lazy_load_aux *aux = page->uninit.aux;
+			if (VM_TYPE (page->uninit.type) != VM_FILE || aux == NULL)
+				return false;
+			file = aux->file;
+			key->ofs = aux->ofs;
+			key->read_bytes = aux->read_bytes;
+			break;
+		}
+		case VM_FILE:
+			file = page->file.file;
+			key->ofs = page->file.ofs;
+			key->read_bytes = page->file.read_bytes;
+			break;
+		default:
+			return false;
+	}
+	key->inode = file_get_inode (file);
+	return true;
+}
+
+static uint64_t
+text_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct frame *f = hash_entry (e, struct frame, tc_elem);
+	return hash_uint64 ((uint64_t) f->inode)
+		^ hash_int (f->ofs) ^ hash_int (f->read_bytes);
+}
+
+static bool
+text_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct frame *a = hash_entry (a_, struct frame, tc_elem);
+	const struct frame *b = hash_entry (b_, struct frame, tc_elem);
+
+	if (a->inode != b->inode)
+		return a->inode < b->inode;
+	if (a->ofs != b->ofs)
+		return a->ofs < b->ofs;
+	return a->read_bytes < b->read_bytes;
+}
+
+/* Enters FRAME, which has just been filled in for PAGE, into the
+ * text cache if PAGE is shareable and no other frame holds it yet.
+ * Called with the frame table lock held. */
+static void
+text_cache_add (struct frame *frame, struct page *page) {
+	struct frame key;
+
+	if (!page_text_key (page, &key))
+		return;
+	frame->inode = key.inode;
+	frame->ofs = key.ofs;
+	frame->read_bytes = key.read_bytes;
+	if (hash_insert (&text_cache, &frame->tc_elem) != NULL)
+		frame->inode = NULL;
+}
+
+/* Maps PAGE to the frame of the text cache that already holds its
+ * contents.  Returns false if PAGE is not shareable or no frame holds
+ * it, in which case the caller loads PAGE as usual. */
+static bool
+vm_share_text_page (struct page *page) {
+	struct frame key, *frame = NULL;
+	struct hash_elem *e;
+	bool success = false;
+
+	if (!page_text_key (page, &key))
+		return false;
+
+	lock_acquire (&frame_lock);
+	e = hash_find (&text_cache, &key.tc_elem);
+	if (e != NULL)
+		frame = hash_entry (e, struct frame, tc_elem);
+	if (frame != NULL && VM_TYPE (page->operations->type) == VM_UNINIT)
+		/* Becomes a file page without reading anything. */
+		page->uninit.page_initializer (page, page->uninit.type, NULL);
+	if (frame != NULL
+			&& pml4_set_page (page->pml4, page->va, frame->kva, false)) {
+		page->frame = frame;
+		rmap_add (frame, page);
+		success = true;
+	}
+	lock_release (&frame_lock);
+	return success;
+}
+
 /* Claim the page that allocate on VA. */
 bool
-vm_claim_page (void *va UNUSED) {
-	struct page *page = NULL;
-	/* TODO: Fill this function */
+vm_claim_page (void *va) {
+	struct page *page = spt_find_page (&thread_current ()->spt, va);
 
+	if (page == NULL)
+		return false;
 	return vm_do_claim_page (page);
 }
 
 /* Claim the PAGE and set up the mmu. */
 static bool
 vm_do_claim_page (struct page *page) {
-	struct frame *frame = vm_get_frame ();
+	struct frame *frame;
+
+	if (vm_share_text_page (page))
+		return true;
+	frame = vm_get_frame (page_wants_zero (page));
+	if (frame == NULL)
+		return false;
+	return vm_map_frame (page, frame);
+}
+
+/* Returns true if PAGE is an anonymous page that has never been
+ * loaded and has no initializer to fill it, so that its frame must
+ * be zeroed rather than show the frame's previous contents. */
+static bool
+page_wants_zero (const struct page *page) {
+	return VM_TYPE (page->operations->type) == VM_UNINIT
+		&& page->uninit.init == NULL
+		&& VM_TYPE (page->uninit.type) == VM_ANON;
+}
 
+/* Links PAGE with FRAME, which is not yet in the frame table, fills
+ * it in and maps it in PAGE's process.  On failure, FRAME is
+ * released and PAGE is left unmapped. */
+static bool
+vm_map_frame (struct page *page, struct frame *frame) {
 	/* Set links */
-	frame->page = page;
 	page->frame = frame;
 
-	/* TODO: Insert page table entry to map page's VA to frame's PA. */
+	if (!pml4_set_page (page->pml4, page->va, frame->kva, page->writable)
+			|| !swap_in (page, frame->kva)) {
+		pml4_clear_page (page->pml4, page->va);
+		page->frame = NULL;
+		vm_release_frame (frame);
+		return false;
+	}
 
-	return swap_in (page, frame->kva);
+	lock_acquire (&frame_lock);
+	rmap_add (frame, page);
+	text_cache_add (frame, page);
+	lock_release (&frame_lock);
+	return true;
+}
+
+/* Claims DST, a page that has just been allocated, with a copy of the
+ * contents of SRC, a loaded page that may have been evicted since.
+ * An evicted SRC is brought back in its own process first, because
+ * swapping in may consume the swapped-out copy. */
+static bool
+vm_copy_claim_page (struct page *dst, struct page *src) {
+	struct frame *frame = vm_get_frame (false);
+
+	if (frame == NULL)
+		return false;
+	for (;;) {
+		lock_acquire (&frame_lock);
+		if (src->frame != NULL) {
+			memcpy (frame->kva, src->frame->kva, PGSIZE);
+			lock_release (&frame_lock);
+			break;
+		}
+		lock_release (&frame_lock);
+		if (!vm_do_claim_page (src)) {
+			vm_release_frame (frame);
+			return false;
+		}
+	}
+	return vm_map_frame (dst, frame);
+}
+
+/* Fault-around.
+ *
+ * A fault on a page of a file-backed region also maps the not yet
+ * loaded pages of the surrounding, window-aligned block of the region
+ * that are cheap to bring in, so that a sequential walk through a
+ * segment takes fewer traps.  Pages found in the text cache and pages
+ * that are all zeros cost no I/O and are always mapped.  Pages that
+ * must be read from the file are mapped only up to FAULT_AROUND_READS
+ * per fault, those after the faulting page first, so that a fault
+ * never waits for more than a few reads it did not ask for.
+ * Prefetching only uses free frames and never evicts.
+ *
+ * The window adapts to the region's history: it doubles when the
+ * pages prefetched by the previous fault were mostly touched, or when
+ * the fault lands right after the previous window, and halves
+ * otherwise.  Newly mapped PTEs start with the accessed bit clear, so
+ * the accessed bits tell which prefetched pages were used. */
+
+/* Most neighbours that one fault reads from the file. */
+#define FAULT_AROUND_READS 4
+
+/* Updates R's window for a fault on VA and returns it. */
+static size_t
+fault_around_adapt (struct vm_region *r, void *va) {
+	uint64_t *pml4 = thread_current ()->pml4;
+	size_t used = 0;
+	bool grow;
+	uint8_t *p;
+
+	if (r->fa_end == NULL)
+		return r->fa_window;
+	if (r->fa_prefetched > 0) {
+		for (p = r->fa_start; p < (uint8_t *) r->fa_end; p += PGSIZE)
+			if (pml4_is_accessed (pml4, p))
+				used++;
+		/* The page that faulted last time was accessed as well. */
+		grow = used > 0 && (used - 1) * 2 >= r->fa_prefetched;
+	} else
+		grow = va == r->fa_end;
+
+	if (grow)
+		r->fa_window *= 2;
+	else
+		r->fa_window /= 2;
+	if (r->fa_window > vm_fault_around_pages)
+		r->fa_window = vm_fault_around_pages;
+	if (r->fa_window < 1)
+		r->fa_window = 1;
+	return r->fa_window;
+}
+
+/* Returns true if loading PAGE, a not yet loaded page of a region,
+ * reads from the file.  Such pages carry a lazy_load_aux. */
+static bool
+page_needs_read (const struct page *page) {
+	const struct lazy_load_aux *aux = page->uninit.aux;
+
+	return aux != NULL && aux->read_bytes > 0;
+}
+
+/* Maps P, a page of R next to a faulting page, if it is not loaded
+ * yet and cheap to load.  *READS is the number of file reads the
+ * fault has left.  Returns false if P could not be mapped for lack
+ * of a frame, which ends the fault-around. */
+static bool
+fault_around_page (struct vm_region *r, struct page *p, size_t *reads) {
+	struct frame *frame;
+
+	if (p == NULL || VM_TYPE (p->operations->type) != VM_UNINIT)
+		return true;
+	if (vm_share_text_page (p)) {
+		r->fa_prefetched++;
+		return true;
+	}
+	if (page_needs_read (p)) {
+		if (*reads == 0)
+			return true;
+		(*reads)--;
+	}
+	frame = vm_alloc_frame (page_wants_zero (p));
+	if (frame == NULL || !vm_map_frame (p, frame))
+		return false;
+	r->fa_prefetched++;
+	return true;
+}
+
+/* Maps the neighbours of PAGE, which has just been claimed. */
+static void
+vm_fault_around (struct supplemental_page_table *spt, struct page *page) {
+	struct vm_region *r;
+	size_t window, reads = FAULT_AROUND_READS;
+	uint8_t *start, *end, *va;
+
+	if (vm_fault_around_pages <= 1)
+		return;
+	r = vm_region_find (spt, page->va);
+	if (r == NULL)
+		return;
+
+	window = fault_around_adapt (r, page->va);
+	start = (uint8_t *) page->va - (pg_no (page->va) % window) * PGSIZE;
+	end = start + window * PGSIZE;
+	if (start < (uint8_t *) r->start)
+		start = r->start;
+	if (end > (uint8_t *) r->end)
+		end = r->end;
+
+	r->fa_start = start;
+	r->fa_end = end;
+	r->fa_prefetched = 0;
+	for (va = (uint8_t *) page->va + PGSIZE; va < end; va += PGSIZE)
+		if (!fault_around_page (r, spt_find_page (spt, va), &reads))
+			return;
+	for (va = start; va < (uint8_t *) page->va; va += PGSIZE)
+		if (!fault_around_page (r, spt_find_page (spt, va), &reads))
+			return;
+}
+
+/* Hashes and orders pages by their user virtual address. */
+static uint64_t
+page_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct page *p = hash_entry (e, struct page, spt_elem);
+	return hash_uint64 ((uint64_t) p->va);
+}
+
+static bool
+page_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct page, spt_elem)->va
+		< hash_entry (b, struct page, spt_elem)->va;
 }
 
 /* Initialize new supplemental page table */
 void
-supplemental_page_table_init (struct supplemental_page_table *spt UNUSED) {
+supplemental_page_table_init (struct supplemental_page_table *spt) {
+	hash_init (&spt->pages, page_hash, page_less, NULL);
+	list_init (&spt->regions);
 }
 
 /* Copy supplemental page table from src to dst */
 bool
-supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
-		struct supplemental_page_table *src UNUSED) {
+supplemental_page_table_copy (struct supplemental_page_table *dst,
+		struct supplemental_page_table *src) {
+	struct hash_iterator i;
+	struct list_elem *e;
+
+	for (e = list_begin (&src->regions); e != list_end (&src->regions);
+			e = list_next (e)) {
+		struct vm_region *r = list_entry (e, struct vm_region, elem);
+		struct vm_region *copy = vm_region_create (dst, r->start, r->end,
+				r->file);
+		if (copy == NULL)
+			return false;
+		copy->fa_window = r->fa_window;
+	}
+
+	hash_first (&i, &src->pages);
+	while (hash_next (&i)) {
+		struct page *page = hash_entry (hash_cur (&i), struct page, spt_elem);
+		enum vm_type type = page->operations->type;
+
+		if (VM_TYPE (type) == VM_UNINIT) {
+			struct lazy_load_aux *aux = NULL;
+
+			if (page->uninit.aux != NULL) {
+				struct vm_region *r = vm_region_find (dst, page->va);
+				aux = malloc (sizeof *aux);
+				if (aux == NULL)
+					return false;
+				memcpy (aux, page->uninit.aux, sizeof *aux);
+				if (r != NULL)
+					aux->file = r->file;
+			}
+			if (!vm_alloc_page_with_initializer (page->uninit.type, page->va,
+						page->writable, page->uninit.init, aux)) {
+				free (aux);
+				return false;
+			}
+		} else if (VM_TYPE (type) == VM_FILE) {
+			/* Shares the parent's frame while it is cached. */
+			struct vm_region *r = vm_region_find (dst, page->va);
+			struct lazy_load_aux *aux = malloc (sizeof *aux);
+			if (aux == NULL)
+				return false;
+			aux->file = r != NULL ? r->file : page->file.file;
+			aux->ofs = page->file.ofs;
+			aux->read_bytes = page->file.read_bytes;
+			aux->zero_bytes = page->file.zero_bytes;
+			if (!vm_alloc_page_with_initializer (VM_FILE, page->va,
+						page->writable, NULL, aux)) {
+				free (aux);
+				return false;
+			}
+			vm_share_text_page (spt_find_page (dst, page->va));
+		} else {
+			if (!vm_alloc_page (type, page->va, page->writable)
+					|| !vm_copy_claim_page (spt_find_page (dst, page->va), page))
+				return false;
+		}
+	}
+	return true;
+}
+
+/* Releases the page of hash element E. */
+static void
+spt_destroy_page (struct hash_elem *e, void *aux UNUSED) {
+	struct page *page = hash_entry (e, struct page, spt_elem);
+
+	vm_free_frame (page);
+	vm_dealloc_page (page);
 }
 
 /* Free the resource hold by the supplemental page table */
 void
-supplemental_page_table_kill (struct supplemental_page_table *spt UNUSED) {
+supplemental_page_table_kill (struct supplemental_page_table *spt) {
 	/* TODO: Destroy all the supplemental_page_table hold by thread and
 	 * TODO: writeback all the modified contents to the storage. */
+	hash_clear (&spt->pages, spt_destroy_page);
+
+	while (!list_empty (&spt->regions)) {
+		struct vm_region *r = list_entry (list_pop_front (&spt->regions),
+				struct vm_region, elem);
+		file_close (r->file);
+		free (r);
+	}
 }
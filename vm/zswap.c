@@ -0,0 +1,129 @@
+/* zswap.c: Compressed in-memory tier in front of the swap disk.
+ *
+ * An evicted anonymous page is first checked for being filled with a
+ * single repeated word, which is kept as that word alone.  Otherwise
+ * it is compressed and the result is kept in kernel memory, as long
+ * as it compresses well and the pool stays under its limit.  Only
+ * the pages that do neither are written to the swap disk. */
+
+#include "vm/zswap.h"
+#include <debug.h>
+#include <lz.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Limit of the pool, in pages of compressed data.  0 disables
+ * compression; same-filled pages are kept regardless.
+ * Set by the "-zs=PAGES" kernel command line option. */
+size_t zswap_max_pages = ZSWAP_DEFAULT_PAGES;
+
+/* Pages that do not compress to this size go to the disk. */
+#define ZSWAP_MAX_SIZE (PGSIZE * 3 / 4)
+
+/* Compression scratch space, the pool size and statistics. */
+static struct lock zswap_lock;
+static uint8_t zswap_buf[ZSWAP_MAX_SIZE];
+static uint8_t zswap_work[LZ_WORK_SIZE];
+static size_t pool_bytes;
+static long long filled_cnt, stored_cnt, reject_cnt, disk_cnt;
+
+void
+zswap_init (void) {
+	lock_init (&zswap_lock);
+}
+
+/* Returns true and stores the fill word in *FILL if every word of
+ * the page at KVA is the same. */
+bool
+zswap_same_filled (const void *kva, uint64_t *fill) {
+	const uint64_t *w = kva;
+	size_t i;
+
+	for (i = 1; i < PGSIZE / sizeof *w; i++)
+		if (w[i] != w[0])
+			return false;
+	*fill = w[0];
+	lock_acquire (&zswap_lock);
+	filled_cnt++;
+	lock_release (&zswap_lock);
+	return true;
+}
+
+/* Fills the page at KVA with the word FILL. */
+void
+zswap_fill (void *kva, uint64_t fill) {
+	uint64_t *w = kva;
+	size_t i;
+
+	for (i = 0; i < PGSIZE / sizeof *w; i++)
+		w[i] = fill;
+}
+
+/* Compresses the page at KVA into the pool.  Returns the compressed
+ * copy and stores its size in *SIZE, or returns a null pointer if the
+ * page does not compress well or the pool is full. */
+void *
+zswap_store (const void *kva, size_t *size) {
+	void *data = NULL;
+	size_t n;
+
+	/* Don't spend the compression on a page that cannot be kept. */
+	if (zswap_max_pages == 0)
+		return NULL;
+	lock_acquire (&zswap_lock);
+	if (pool_bytes >= zswap_max_pages * PGSIZE) {
+		reject_cnt++;
+		lock_release (&zswap_lock);
+		return NULL;
+	}
+	n = lz_compress (kva, PGSIZE, zswap_buf, sizeof zswap_buf, zswap_work);
+	if (n > 0 && pool_bytes + n <= zswap_max_pages * PGSIZE)
+		data = malloc (n);
+	if (data != NULL) {
+		memcpy (data, zswap_buf, n);
+		pool_bytes += n;
+		stored_cnt++;
+		*size = n;
+	} else
+		reject_cnt++;
+	lock_release (&zswap_lock);
+	return data;
+}
+
+/* Decompresses DATA, SIZE bytes returned by zswap_store(), into the
+ * page at KVA. */
+void
+zswap_load (const void *data, size_t size, void *kva) {
+	size_t n = lz_decompress (data, size, kva, PGSIZE);
+
+	if (n != PGSIZE)
+		PANIC ("zswap: corrupt compressed page");
+}
+
+/* Releases DATA, SIZE bytes returned by zswap_store(). */
+void
+zswap_free (void *data, size_t size) {
+	lock_acquire (&zswap_lock);
+	pool_bytes -= size;
+	lock_release (&zswap_lock);
+	free (data);
+}
+
+/* Counts a page that had to be written to the swap disk. */
+void
+zswap_count_disk_write (void) {
+	lock_acquire (&zswap_lock);
+	disk_cnt++;
+	lock_release (&zswap_lock);
+}
+
+/* Prints swap statistics. */
+void
+zswap_print_stats (void) {
+	printf ("Swap: %lld same-filled, %lld compressed, %lld rejected, "
+			"%lld to disk, %zu bytes in pool\n",
+			filled_cnt, stored_cnt, reject_cnt, disk_cnt, pool_bytes);
+}